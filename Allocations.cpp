@@ -0,0 +1,111 @@
+#include "pch.h"
+#include "Allocations.h"
+
+#ifdef ETTT_ALLOC_TRACKING
+
+#include <cstdlib>
+#include <new>
+
+// constant initialized, so counting works from the very first allocation of a thread
+static thread_local Allocations::Counts t_counts;
+
+Allocations::Counts Allocations::GetThreadCounts() {
+  return t_counts;
+}
+
+// calls the new handler until allocate succeeds, as operator new must
+template <typename Allocate>
+static void* AllocateOrThrow(std::size_t size, Allocate allocate) {
+  while (true) {
+    if (void* ptr = allocate()) {
+      t_counts.allocations++;
+      t_counts.bytes += size;
+      return ptr;
+    }
+    std::new_handler handler = std::get_new_handler();
+    if (!handler)
+      throw std::bad_alloc();
+    handler();
+  }
+}
+
+static void* Allocate(std::size_t size) {
+  // malloc may return nullptr for 0 bytes, operator new may not
+  return AllocateOrThrow(size, [size] { return std::malloc(size ? size : 1); });
+}
+
+static void* AllocateAligned(std::size_t size, std::align_val_t alignment) {
+  const std::size_t align = static_cast<std::size_t>(alignment);
+  return AllocateOrThrow(size, [size, align] {
+#ifdef _WIN32
+    return _aligned_malloc(size ? size : 1, align);
+#else
+    // the size has to be a multiple of the alignment
+    return std::aligned_alloc(align, std::max(align, (size + align - 1) / align * align));
+#endif
+  });
+}
+
+static void FreeAligned(void* ptr) {
+#ifdef _WIN32
+  _aligned_free(ptr);
+#else
+  std::free(ptr);
+#endif
+}
+
+void* operator new(std::size_t size) { return Allocate(size); }
+void* operator new[](std::size_t size) { return Allocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return AllocateAligned(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return AllocateAligned(size, alignment); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  try {
+    return Allocate(size);
+  } catch (const std::bad_alloc&) {
+    return nullptr;
+  }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  try {
+    return Allocate(size);
+  } catch (const std::bad_alloc&) {
+    return nullptr;
+  }
+}
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+  try {
+    return AllocateAligned(size, alignment);
+  } catch (const std::bad_alloc&) {
+    return nullptr;
+  }
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+  try {
+    return AllocateAligned(size, alignment);
+  } catch (const std::bad_alloc&) {
+    return nullptr;
+  }
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, std::align_val_t) noexcept { FreeAligned(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { FreeAligned(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { FreeAligned(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { FreeAligned(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { FreeAligned(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { FreeAligned(ptr); }
+
+#else
+
+Allocations::Counts Allocations::GetThreadCounts() {
+  return {};
+}
+
+#endif
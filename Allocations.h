@@ -0,0 +1,50 @@
+#pragma once
+
+/**
+ * Counts the heap allocations of every thread, to catch the ones creeping
+ * into code meant to run without any, e.g. the search once it is warmed up.
+ *
+ * Counting replaces the global operator new and delete, so it is only
+ * compiled in when ETTT_ALLOC_TRACKING is defined (cmake option
+ * EXTREME_TTT_ALLOC_TRACKING). Otherwise the default allocator is left
+ * alone and every count stays at 0.
+ */
+namespace Allocations {
+
+struct Counts {
+  uint64_t allocations = 0;
+  uint64_t bytes = 0;
+
+  Counts operator-(const Counts& other) const {
+    return {allocations - other.allocations, bytes - other.bytes};
+  }
+};
+
+constexpr bool IsTracking() {
+#ifdef ETTT_ALLOC_TRACKING
+  return true;
+#else
+  return false;
+#endif
+}
+
+// allocations made by the calling thread since it started
+Counts GetThreadCounts();
+
+/**
+ * Allocations made by the calling thread since the scope was created
+ *
+ *   Allocations::Scope scope;
+ *   Search();
+ *   assert(scope.Get().allocations == 0);
+ */
+class Scope {
+public:
+  Scope() : m_start(GetThreadCounts()) {}
+  Counts Get() const { return GetThreadCounts() - m_start; }
+
+private:
+  Counts m_start;
+};
+
+} // namespace Allocations
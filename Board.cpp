@@ -1,19 +1,6 @@
 #include "pch.h"
 #include "Board.h"
-
-const std::array<std::array<int, 3>, 8> Board::s_indices = {{
-    // rows
-    {{0, 1, 2}},
-    {{3, 4, 5}},
-    {{6, 7, 8}},
-    // columns
-    {{0, 3, 6}},
-    {{1, 4, 7}},
-    {{2, 5, 8}},
-    // diags
-    {{0, 4, 8}},
-    {{2, 4, 6}},
-}};
+#include "SmallBoard.h"
 
 /**
  * Initializes the mapping for s_boardIndexConversion
@@ -41,6 +28,67 @@ constexpr std::array<int, 9 * 9> calcBoardIndexConversion() {
 
 const std::array<int, 9 * 9> s_boardIndexConversion = calcBoardIndexConversion();
 
+// splitmix64, so the keys do not depend on the standard library
+constexpr uint64_t nextZobristKey(uint64_t& state) {
+  uint64_t z = (state += 0x9e3779b97f4a7c15);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+  return z ^ (z >> 31);
+}
+
+struct ZobristKeys {
+  // per player and per board * 9 + cell
+  std::array<std::array<uint64_t, 9 * 9>, 2> pieces = {};
+  uint64_t oToMove = 0;
+  // indexed by forced board + 1
+  std::array<uint64_t, 10> forcedBoards = {};
+};
+
+constexpr ZobristKeys calcZobristKeys() {
+  ZobristKeys keys;
+  uint64_t state = 20241105;
+  for (auto& side : keys.pieces) {
+    for (uint64_t& key : side)
+      key = nextZobristKey(state);
+  }
+  keys.oToMove = nextZobristKey(state);
+  for (uint64_t& key : keys.forcedBoards)
+    key = nextZobristKey(state);
+  return keys;
+}
+
+static constexpr ZobristKeys s_zobrist = calcZobristKeys();
+const std::array<uint64_t, 10> Board::s_forcedBoardKeys = s_zobrist.forcedBoards;
+
+/**
+ * Where each cell of a 3x3 grid goes under each symmetry:
+ * identity, the 3 rotations, then the 4 reflections
+ */
+constexpr std::array<std::array<int, 9>, Board::s_symmetryCount> calcSymmetries() {
+  std::array<std::array<int, 9>, Board::s_symmetryCount> symmetries = {};
+  for (int cell = 0; cell < 9; cell++) {
+    int r = cell / 3;
+    int c = cell % 3;
+    const std::array<std::pair<int, int>, Board::s_symmetryCount> images = {{
+        {r, c},
+        {c, 2 - r},
+        {2 - r, 2 - c},
+        {2 - c, r},
+        {r, 2 - c},
+        {2 - r, c},
+        {c, r},
+        {2 - c, 2 - r},
+    }};
+    for (int s = 0; s < Board::s_symmetryCount; s++)
+      symmetries[s][cell] = images[s].first * 3 + images[s].second;
+  }
+  return symmetries;
+}
+
+static constexpr std::array<std::array<int, 9>, Board::s_symmetryCount> s_symmetries = calcSymmetries();
+// the rotations by 90 and 270 degrees undo each other, the others undo themselves
+static constexpr std::array<int, Board::s_symmetryCount> s_inverseSymmetries = {0, 3, 2, 1, 4, 5, 6, 7};
+
 std::ostream& operator<<(std::ostream& os, const Piece& piece) {
   switch (piece) {
   case Piece::X:
@@ -86,74 +134,62 @@ std::ostream& operator<<(std::ostream& os, const GameStatus& status) {
   return os;
 }
 
-static Piece player2piece(PlayerSymbol player) {
-  if (player == PlayerSymbol::X) {
-    return Piece::X;
-  } else {
-    return Piece::O;
-  }
-}
-
-Board::Board(std::string boardStr, const Move& lastMove)
-    : m_lastMove(lastMove) {
-  // remove all whitespace
-  boardStr.erase(std::remove_if(boardStr.begin(), boardStr.end(), ::isspace),
-                 boardStr.end());
-  // count number of X and O
-  uint64_t xCount = std::count(boardStr.begin(), boardStr.end(), 'x');
-  uint64_t oCount = std::count(boardStr.begin(), boardStr.end(), 'o');
+// std::isspace in the C locale, without a call into the C library for every character
+static bool IsSpace(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
 
-  // check if the board is valid
-  if (xCount < oCount || xCount > oCount + 1 || boardStr.size() != 9 * 9) {
-    SPDLOG_CRITICAL("Invalid board string");
-  }
-
-  for (int i = 0; i < 9 * 9; i++) {
-    char c = boardStr[i];
-    Piece piece;
-    if (c == 'x') {
-      piece = Piece::X;
-    } else if (c == 'o') {
-      piece = Piece::O;
-    } else {
-      piece = Piece::Empty;
+Board::Board(std::string_view boardStr, const Move& lastMove) {
+  // whitespace is ignored, anything else than x and o is an empty cell
+  int count = 0;
+  for (char c : boardStr) {
+    if (IsSpace(c))
+      continue;
+    if (count < 9 * 9 && (c == 'x' || c == 'o')) {
+      int idx = s_boardIndexConversion[count];
+      m_cellMasks[c == 'x' ? 0 : 1][idx / 9] |= static_cast<uint16_t>(1 << (idx % 9));
     }
-    int col = i % 9;
-    int row = i / 9;
-    int idx = s_boardIndexConversion[row * 9 + col];
-    m_board[idx] = piece;
+    count++;
   }
 
-  // Now we need to update the status of the big board
-  // by going through each of the small boards and
-  // checking if the game is in progress or if one
-  // of the players has won
-  for (int i = 0; i < 9; i++) {
-    m_bigBoard[i] = CalcGameStatus(PlayerSymbol::X, i);
-    if (m_bigBoard[i] == GameStatus::XWins)
-      continue;
-
-    m_bigBoard[i] = CalcGameStatus(PlayerSymbol::O, i);
+  // the player to move follows from the number of pieces
+  std::array<int, 2> counts = InitFromCellMasks(PlayerSymbol::X, lastMove);
+  if (counts[0] < counts[1] || counts[0] > counts[1] + 1 || count != 9 * 9) {
+    SPDLOG_CRITICAL("Invalid board string");
+  }
+  if (counts[0] != counts[1]) {
+    m_currentPlayer = PlayerSymbol::O;
+    m_key ^= s_zobrist.oToMove;
   }
-
-  // and then we need to update the status of the
-  // entire game
-  m_topGameStatus = CalcGameStatus(PlayerSymbol::X);
-  if (m_topGameStatus != GameStatus::XWins)
-    m_topGameStatus = CalcGameStatus(PlayerSymbol::O);
-
-  // now we can set the actual current player
-  m_currentPlayer = xCount == oCount ? PlayerSymbol::X : PlayerSymbol::O;
-
   SPDLOG_DEBUG("Initialized board with last move {}", lastMove);
 }
 
-bool Board::IsBoardFull(int boardPosition) const {
-  const auto& start = m_board.begin() + boardPosition * 9;
-  const auto& end = start + 9;
-  return std::all_of(start, end, [](Piece piece) {
-    return piece != Piece::Empty;
-  });
+std::array<int, 2> Board::InitFromCellMasks(PlayerSymbol currentPlayer, std::optional<Move> lastMove) {
+  // every cell is visited without branching on what is in it,
+  // bulk loading positions would otherwise mispredict most of them
+  std::array<int, 2> counts = {0, 0};
+  for (int boardPosition = 0; boardPosition < 9; boardPosition++) {
+    const int xMask = m_cellMasks[0][boardPosition];
+    const int oMask = m_cellMasks[1][boardPosition];
+    for (int cell = 0; cell < 9; cell++) {
+      const int idx = boardPosition * 9 + cell;
+      const int isX = (xMask >> cell) & 1;
+      const int isO = (oMask >> cell) & 1;
+      m_board[idx] = static_cast<Piece>(isX - isO);
+      m_key ^= (s_zobrist.pieces[0][idx] & (0 - static_cast<uint64_t>(isX))) ^
+               (s_zobrist.pieces[1][idx] & (0 - static_cast<uint64_t>(isO)));
+      counts[0] += isX;
+      counts[1] += isO;
+    }
+    // the status of the big board comes from each of the small boards
+    SetBoardStatus(boardPosition, CalcGameStatus(boardPosition));
+  }
+  // and then the status of the entire game from the big board
+  m_topGameStatus = CalcGameStatus();
+
+  m_currentPlayer = currentPlayer;
+  if (m_currentPlayer == PlayerSymbol::O)
+    m_key ^= s_zobrist.oToMove;
+  m_lastMove = lastMove;
+  return counts;
 }
 
 bool Board::IsMoveLegal(const Move& move) const {
@@ -179,6 +215,12 @@ bool Board::IsMoveLegal(const Move& move) const {
   return true;
 }
 
+int Board::GetForcedBoard() const {
+  if (!m_lastMove || m_bigBoard[m_lastMove->m_cellPosition] != GameStatus::InProgress)
+    return -1;
+  return m_lastMove->m_cellPosition;
+}
+
 std::vector<Move> Board::GetLegalMoves() const {
   std::vector<Move> moves;
   for (int i = 0; i < 9 * 9; i++) {
@@ -193,20 +235,98 @@ void Board::Play(const Move& move) {
   if (!IsMoveLegal(move)) {
     SPDLOG_CRITICAL("Invalid move {}", move);
   }
+  if (m_currentPlayer == PlayerSymbol::X)
+    Play<PlayerSymbol::X>(move);
+  else
+    Play<PlayerSymbol::O>(move);
+}
+
+template <PlayerSymbol Us>
+void Board::Play(const Move& move) {
   int index = move.m_boardPosition * 9 + move.m_cellPosition;
-  m_board[index] = player2piece(m_currentPlayer);
+  m_board[index] = ToPiece(Us);
+  m_cellMasks[SideIndex(Us)][move.m_boardPosition] |= static_cast<uint16_t>(1 << move.m_cellPosition);
+  m_key ^= s_zobrist.pieces[SideIndex(Us)][index] ^ s_zobrist.oToMove;
   m_lastMove = move;
 
-  // update the status of the big board
-  m_bigBoard[move.m_boardPosition] = CalcGameStatus(m_currentPlayer, move.m_boardPosition);
-  m_topGameStatus = CalcGameStatus(m_currentPlayer);
+  // update the status of the big board, the game
+  // can only end when one of its boards does
+  GameStatus status = CalcGameStatus(move.m_boardPosition);
+  if (status != GameStatus::InProgress) {
+    SetBoardStatus(move.m_boardPosition, status);
+    m_topGameStatus = CalcGameStatus();
+  }
 
   // switch current player
+  m_currentPlayer = Opponent(Us);
+}
+
+template void Board::Play<PlayerSymbol::X>(const Move& move);
+template void Board::Play<PlayerSymbol::O>(const Move& move);
+
+static Piece player2piece(PlayerSymbol player) {
+  if (player == PlayerSymbol::X) {
+    return Piece::X;
+  } else {
+    return Piece::O;
+  }
+}
+
+void Board::PlayDynamic(const Move& move) {
+  int index = move.m_boardPosition * 9 + move.m_cellPosition;
+  m_board[index] = player2piece(m_currentPlayer);
+  m_cellMasks[SideIndex(m_currentPlayer)][move.m_boardPosition] |= static_cast<uint16_t>(1 << move.m_cellPosition);
+  m_key ^= s_zobrist.pieces[SideIndex(m_currentPlayer)][index] ^ s_zobrist.oToMove;
+  m_lastMove = move;
+
+  GameStatus status = CalcGameStatus(m_currentPlayer, move.m_boardPosition);
+  if (status != GameStatus::InProgress) {
+    SetBoardStatus(move.m_boardPosition, status);
+    m_topGameStatus = CalcGameStatus(m_currentPlayer);
+  }
+
   m_currentPlayer = GetOtherPlayer();
 }
 
+void Board::SetBoardStatus(int boardPosition, GameStatus status) {
+  m_bigBoard[boardPosition] = status;
+  if (status == GameStatus::InProgress)
+    return;
+  uint16_t bit = static_cast<uint16_t>(1 << boardPosition);
+  m_closedBoards |= bit;
+  if (status == GameStatus::XWins)
+    m_wonBoards[0] |= bit;
+  else if (status == GameStatus::OWins)
+    m_wonBoards[1] |= bit;
+}
+
 Move ConvertIdxToMove(int idx) { return Move(idx / 9, idx % 9); }
 
+uint64_t Board::GetKey(int symmetry) const {
+  const std::array<int, 9>& map = s_symmetries[symmetry];
+  uint64_t key = m_currentPlayer == PlayerSymbol::O ? s_zobrist.oToMove : 0;
+  for (int boardPosition = 0; boardPosition < 9; boardPosition++) {
+    for (int side = 0; side < 2; side++) {
+      uint16_t mask = m_cellMasks[side][boardPosition];
+      for (int cell = 0; cell < 9; cell++) {
+        if (mask & (1 << cell))
+          key ^= s_zobrist.pieces[side][map[boardPosition] * 9 + map[cell]];
+      }
+    }
+  }
+  int forced = GetForcedBoard();
+  return key ^ s_forcedBoardKeys[forced < 0 ? 0 : map[forced] + 1];
+}
+
+Move Board::TransformMove(const Move& move, int symmetry) {
+  const std::array<int, 9>& map = s_symmetries[symmetry];
+  return Move(map[move.m_boardPosition], map[move.m_cellPosition]);
+}
+
+Move Board::InverseTransformMove(const Move& move, int symmetry) {
+  return TransformMove(move, s_inverseSymmetries[symmetry]);
+}
+
 void Board::PrintPiece(std::ostream& os, int row, int col) const {
   int idx = s_boardIndexConversion[row * 9 + col];
   const Piece piece = m_board[idx];
@@ -242,82 +362,236 @@ std::ostream& operator<<(std::ostream& os, const Board& game) {
   return os;
 }
 
-GameStatus Board::GetGameStatus_IMPL(PlayerSymbol currentPlayer, const Piece* board) const {
-  // only the last player that played in the board can win
-  Piece piece = player2piece(currentPlayer);
-  for (const auto [idx0, idx1, idx2] : s_indices) {
-    if (board[idx0] == piece &&
-        board[idx1] == piece &&
-        board[idx2] == piece) {
-      return currentPlayer == PlayerSymbol::X ? GameStatus::XWins
-                                              : GameStatus::OWins;
-    }
-  }
+GameStatus Board::CalcGameStatus(int boardPosition) const {
+  // only the last player that played in a board can have a line
+  // in it, so the table never has to pick between two winners
+  return GetSmallBoardInfo(m_cellMasks[0][boardPosition], m_cellMasks[1][boardPosition]).status;
+}
 
-  // check if the board is full
-  if (std::all_of(board, board + 9, [](Piece piece) {
-        return piece != Piece::Empty;
-      })) {
-    return GameStatus::Draw;
-  }
+// whether the cells of one player, bit i is cell i, make a line
+static bool HasLine(uint16_t cells) {
+  return GetSmallBoardInfo(cells, 0).status == GameStatus::XWins;
+}
 
+GameStatus Board::CalcGameStatus(PlayerSymbol player, int boardPosition) const {
+  if (HasLine(m_cellMasks[SideIndex(player)][boardPosition]))
+    return player == PlayerSymbol::X ? GameStatus::XWins : GameStatus::OWins;
+  if ((m_cellMasks[0][boardPosition] | m_cellMasks[1][boardPosition]) == s_fullCellMask)
+    return GameStatus::Draw;
   return GameStatus::InProgress;
 }
 
-GameStatus Board::CalcGameStatus(PlayerSymbol currentPlayer, int boardPosition) const {
-  return GetGameStatus_IMPL(currentPlayer, m_board.data() + boardPosition * 9);
+GameStatus Board::CalcGameStatus(PlayerSymbol player) const {
+  if (HasLine(m_wonBoards[SideIndex(player)]))
+    return player == PlayerSymbol::X ? GameStatus::XWins : GameStatus::OWins;
+  if (m_closedBoards == s_fullCellMask)
+    return GameStatus::Draw;
+  return GameStatus::InProgress;
 }
 
-GameStatus Board::CalcGameStatus(PlayerSymbol player) const {
-  // only the last player that played on the board can win
-  GameStatus status = player == PlayerSymbol::X ? GameStatus::XWins
-                                                : GameStatus::OWins;
-  for (const auto& [idx0, idx1, idx2] : s_indices) {
-    if (m_bigBoard[idx0] == status &&
-        m_bigBoard[idx1] == status &&
-        m_bigBoard[idx2] == status) {
-      return status;
-    }
-  }
+GameStatus Board::CalcGameStatus() const {
+  // the big board is a small board where the
+  // cells are the sub boards won by each player
+  GameStatus status = GetSmallBoardInfo(m_wonBoards[0], m_wonBoards[1]).status;
+  if (status == GameStatus::XWins || status == GameStatus::OWins)
+    return status;
 
   // if no boards are in progress, the game is a draw
-  if (std::all_of(m_bigBoard.begin(), m_bigBoard.end(), [](GameStatus status) {
-        return status != GameStatus::InProgress;
-      })) {
+  if (m_closedBoards == s_fullCellMask)
     return GameStatus::Draw;
-  }
 
   return GameStatus::InProgress;
 }
 
 std::size_t hash_value(const Board& board) {
-  std::size_t seed = 0;
-  std::hash<int> int_hasher;
+  // boards that compare equal have the same forced board, so the same key
+  return static_cast<std::size_t>(board.GetKey());
+}
+
+bool operator==(const Board& lhs, const Board& rhs) {
+  return lhs.m_board == rhs.m_board &&
+         lhs.m_bigBoard == rhs.m_bigBoard &&
+         lhs.m_currentPlayer == rhs.m_currentPlayer &&
+         lhs.m_lastMove == rhs.m_lastMove;
+}
 
-  // Hash the main board
-  for (const auto& piece : board.m_board) {
-    seed ^= int_hasher(static_cast<int>(piece)) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+[[noreturn]] static void ThrowInvalidNotation(std::string_view notation, const char* reason) {
+  throw std::invalid_argument(fmt::format("Invalid notation \"{}\": {}", notation, reason));
+}
+
+// what each character of the sub boards in the notation stands for:
+// the number of cells it covers, and whether it is an x, an o or a '/'.
+// 0 for the characters that cannot appear there
+static constexpr uint8_t s_notationCellsMask = 0xf;
+static constexpr uint8_t s_notationX = 0x10;
+static constexpr uint8_t s_notationO = 0x20;
+static constexpr uint8_t s_notationSlash = 0x40;
+static constexpr std::array<uint8_t, 256> s_notationChars = [] {
+  std::array<uint8_t, 256> chars = {};
+  chars['x'] = s_notationX | 1;
+  chars['o'] = s_notationO | 1;
+  chars['/'] = s_notationSlash;
+  for (int count = 1; count <= 9; count++)
+    chars['0' + count] = static_cast<uint8_t>(count);
+  return chars;
+}();
+
+Board Board::FromNotation(std::string_view notation) {
+  Board board;
+  // the masks of the current sub board stay in registers, updating the
+  // board in memory chains every character on a store and a load
+  int xMask = 0;
+  int oMask = 0;
+  int boardPosition = 0;
+  int cell = 0;
+  std::size_t i = 0;
+  for (; i < notation.size() && notation[i] != ' '; i++) {
+    const uint8_t info = s_notationChars[static_cast<uint8_t>(notation[i])];
+    if (info & s_notationSlash) {
+      if (cell != 9 || boardPosition == 8)
+        ThrowInvalidNotation(notation, "expected 9 sub boards of 9 cells");
+      board.m_cellMasks[0][boardPosition] = static_cast<uint16_t>(xMask);
+      board.m_cellMasks[1][boardPosition] = static_cast<uint16_t>(oMask);
+      xMask = oMask = 0;
+      boardPosition++;
+      cell = 0;
+      continue;
+    }
+    const int cells = info & s_notationCellsMask;
+    if (cells == 0 || cell + cells > 9)
+      ThrowInvalidNotation(notation, info ? "a sub board has more than 9 cells" : "unexpected character in the sub boards");
+    const int isX = (info & s_notationX) != 0;
+    const int isO = (info & s_notationO) != 0;
+    xMask |= isX << cell;
+    oMask |= isO << cell;
+    cell += cells;
   }
+  if (boardPosition != 8 || cell != 9)
+    ThrowInvalidNotation(notation, "expected 9 sub boards of 9 cells");
+  board.m_cellMasks[0][8] = static_cast<uint16_t>(xMask);
+  board.m_cellMasks[1][8] = static_cast<uint16_t>(oMask);
+
+  // then " <player> <forced board>", maybe followed by whitespace
+  if (notation.size() < i + 4 || notation[i + 2] != ' ')
+    ThrowInvalidNotation(notation, "expected the player to move and the forced board");
+  for (std::size_t j = i + 4; j < notation.size(); j++) {
+    if (!IsSpace(notation[j]))
+      ThrowInvalidNotation(notation, "unexpected characters at the end");
+  }
+  const char player = notation[i + 1];
+  const char forcedChar = notation[i + 3];
+  if (player != 'x' && player != 'o')
+    ThrowInvalidNotation(notation, "the player to move must be x or o");
+  if (forcedChar != '-' && (forcedChar < '0' || forcedChar > '8'))
+    ThrowInvalidNotation(notation, "the forced board must be - or a digit from 0 to 8");
+  const PlayerSymbol currentPlayer = player == 'x' ? PlayerSymbol::X : PlayerSymbol::O;
+  const int forced = forcedChar == '-' ? -1 : forcedChar - '0';
+
+  const std::array<int, 2> counts = board.InitFromCellMasks(currentPlayer, std::nullopt);
+  if (counts[0] != counts[1] + (currentPlayer == PlayerSymbol::O ? 1 : 0))
+    ThrowInvalidNotation(notation, "the number of pieces does not match the player to move");
+  if (counts[0] == 0) {
+    if (forced >= 0)
+      ThrowInvalidNotation(notation, "the first move can be played in any board");
+    return board;
+  }
+  if (forced >= 0 && board.m_bigBoard[forced] != GameStatus::InProgress)
+    ThrowInvalidNotation(notation, "the forced board is finished");
+
+  // any move of the opponent that leads to the forced board will do
+  const uint16_t* lastPlayerMasks = board.m_cellMasks[SideIndex(Opponent(currentPlayer))].data();
+  for (int lastBoard = 0; lastBoard < 9 && !board.m_lastMove; lastBoard++) {
+    for (uint16_t mask = lastPlayerMasks[lastBoard]; mask; mask &= mask - 1) {
+      int lastCell = std::countr_zero(mask);
+      if (forced >= 0 ? lastCell == forced : board.m_bigBoard[lastCell] != GameStatus::InProgress) {
+        board.m_lastMove = Move(lastBoard, lastCell);
+        break;
+      }
+    }
+  }
+  if (!board.m_lastMove)
+    ThrowInvalidNotation(notation, "no move of the last player leads to the forced board");
+  return board;
+}
 
-  // Hash the big board status
-  for (const auto& status : board.m_bigBoard) {
-    seed ^= int_hasher(static_cast<int>(status)) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+char* Board::WriteNotation(char* out) const {
+  for (int boardPosition = 0; boardPosition < 9; boardPosition++) {
+    if (boardPosition > 0)
+      *out++ = '/';
+    int empty = 0;
+    for (int cell = 0; cell < 9; cell++) {
+      Piece piece = m_board[boardPosition * 9 + cell];
+      if (piece == Piece::Empty) {
+        empty++;
+        continue;
+      }
+      if (empty > 0)
+        *out++ = static_cast<char>('0' + empty);
+      empty = 0;
+      *out++ = piece == Piece::X ? 'x' : 'o';
+    }
+    if (empty > 0)
+      *out++ = static_cast<char>('0' + empty);
   }
+  *out++ = ' ';
+  *out++ = m_currentPlayer == PlayerSymbol::X ? 'x' : 'o';
+  *out++ = ' ';
+  int forced = GetForcedBoard();
+  *out++ = forced < 0 ? '-' : static_cast<char>('0' + forced);
+  return out;
+}
 
-  // Hash the current player
-  seed ^= int_hasher(static_cast<int>(board.m_currentPlayer)) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+std::string Board::ToNotation() const {
+  char buffer[s_maxNotationSize];
+  return std::string(buffer, WriteNotation(buffer));
+}
 
-  // Hash the last move, if it exists
-  if (board.m_lastMove) {
-    seed ^= int_hasher(board.m_lastMove->m_cellPosition) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+PackedBoard Board::Pack() const {
+  PackedBoard packed;
+  for (int boardPosition = 0; boardPosition < 9; boardPosition++)
+    packed.boards[boardPosition] = static_cast<uint16_t>(s_base3[m_cellMasks[0][boardPosition]] +
+                                                         2 * s_base3[m_cellMasks[1][boardPosition]]);
+  if (m_lastMove)
+    packed.lastMove = static_cast<uint8_t>(m_lastMove->m_boardPosition * 9 + m_lastMove->m_cellPosition);
+  packed.flags = m_currentPlayer == PlayerSymbol::O ? 1 : 0;
+  return packed;
+}
+
+Board Board::Unpack(const PackedBoard& packed) {
+  if (packed.flags & ~1)
+    throw std::invalid_argument(fmt::format("Invalid packed flags {}", packed.flags));
+  Board board;
+  for (int boardPosition = 0; boardPosition < 9; boardPosition++) {
+    int state = packed.boards[boardPosition];
+    if (state >= s_smallBoardStates)
+      throw std::invalid_argument(fmt::format("Invalid packed sub board {}", state));
+    int xMask = 0;
+    int oMask = 0;
+    for (int cell = 0; cell < 9; cell++, state /= 3) {
+      xMask |= (state % 3 == 1) << cell;
+      oMask |= (state % 3 == 2) << cell;
+    }
+    board.m_cellMasks[0][boardPosition] = static_cast<uint16_t>(xMask);
+    board.m_cellMasks[1][boardPosition] = static_cast<uint16_t>(oMask);
   }
 
-  return seed;
+  std::optional<Move> lastMove;
+  if (packed.lastMove != PackedBoard::s_noLastMove) {
+    if (packed.lastMove >= 9 * 9)
+      throw std::invalid_argument(fmt::format("Invalid packed last move {}", packed.lastMove));
+    lastMove = ConvertIdxToMove(packed.lastMove);
+  }
+  const PlayerSymbol currentPlayer = packed.flags & 1 ? PlayerSymbol::O : PlayerSymbol::X;
+  // the same checks as FromNotation, which finds a last move instead of reading it
+  if (lastMove) {
+    const uint16_t lastPlayerMask = board.GetCellMask(Opponent(currentPlayer), lastMove->m_boardPosition);
+    if (!(lastPlayerMask >> lastMove->m_cellPosition & 1))
+      throw std::invalid_argument("Invalid packed board, the last move is not a piece of the last player");
+  }
+  const std::array<int, 2> counts = board.InitFromCellMasks(currentPlayer, lastMove);
+  if (counts[0] != counts[1] + (currentPlayer == PlayerSymbol::O ? 1 : 0))
+    throw std::invalid_argument("Invalid packed board, the number of pieces does not match the player to move");
+  if (counts[0] > 0 && !lastMove)
+    throw std::invalid_argument("Invalid packed board, there are pieces but no last move");
+  return board;
 }
-
-bool operator==(const Board& lhs, const Board& rhs) {
-  return lhs.m_board == rhs.m_board &&
-         lhs.m_bigBoard == rhs.m_bigBoard &&
-         lhs.m_currentPlayer == rhs.m_currentPlayer &&
-         lhs.m_lastMove == rhs.m_lastMove;
-}
\ No newline at end of file
@@ -2,7 +2,7 @@
 
 #include "Move.h"
 
-enum class Piece {
+enum class Piece : int8_t {
   X = 1,
   O = -1,
   Empty = 0
@@ -12,7 +12,7 @@ std::ostream& operator<<(std::ostream& os, const Piece& piece);
 template <>
 struct fmt::formatter<Piece> : fmt::ostream_formatter {};
 
-enum class PlayerSymbol {
+enum class PlayerSymbol : int8_t {
   X = 1,
   O = -1
 };
@@ -21,7 +21,12 @@ std::ostream& operator<<(std::ostream& os, const PlayerSymbol& player);
 template <>
 struct fmt::formatter<PlayerSymbol> : fmt::ostream_formatter {};
 
-enum class GameStatus {
+constexpr PlayerSymbol Opponent(PlayerSymbol player) {
+  return static_cast<PlayerSymbol>(-static_cast<int>(player));
+}
+constexpr Piece ToPiece(PlayerSymbol player) { return static_cast<Piece>(static_cast<int>(player)); }
+
+enum class GameStatus : uint8_t {
   InProgress,
   XWins,
   OWins,
@@ -38,21 +43,95 @@ Move ConvertIdxToMove(int idx);
 // (row * 9 + col) to an index in m_board
 extern const std::array<int, 9 * 9> s_boardIndexConversion;
 
+/**
+ * Fixed size binary form of a Board, see Board::Pack. It keeps the
+ * exact last move, unlike the text notation.
+ */
+struct PackedBoard {
+  // each sub board as a base 3 number, one digit per cell: 0 empty, 1 X, 2 O
+  std::array<uint16_t, 9> boards = {};
+  // board * 9 + cell of the last move, s_noLastMove before the first move
+  uint8_t lastMove = s_noLastMove;
+  // bit 0 is set when O is to move, the other bits are 0
+  uint8_t flags = 0;
+
+  static constexpr uint8_t s_noLastMove = 0xff;
+};
+static_assert(sizeof(PackedBoard) == 20, "packed boards are written as is");
+
 class Board {
 public:
   Board() = default;
-  Board(std::string boardStr, const Move& lastMove);
+  Board(std::string_view boardStr, const Move& lastMove);
+
+  /**
+   * Reads the one line notation written by ToNotation, e.g. the position
+   * after X played in the center of the center board:
+   *
+   *   9/9/9/9/4x4/9/9/9/9 o 4
+   *
+   * The 9 sub boards come first, separated by '/', each listing its cells
+   * in order as x, o or a digit counting empty cells. Then the player to
+   * move and the forced sub board, '-' when any board can be played.
+   * The last move is not part of the notation, a move of the opponent
+   * leading to the forced board is assumed. Nothing is allocated unless
+   * the notation is invalid.
+   *
+   * @throws std::invalid_argument if the notation or the position is invalid
+   */
+  static Board FromNotation(std::string_view notation);
+  // longest notation, with every cell taken
+  static constexpr std::size_t s_maxNotationSize = 9 * 9 + 8 + 4;
+  std::string ToNotation() const;
+  /**
+   * Writes the notation without a terminating null character
+   *
+   * @param out room for at least s_maxNotationSize characters
+   * @return the end of what was written
+   */
+  char* WriteNotation(char* out) const;
+
+  PackedBoard Pack() const;
+  // @throws std::invalid_argument if packed does not hold a valid position
+  static Board Unpack(const PackedBoard& packed);
 
   friend bool operator==(const Board& lhs, const Board& rhs);
   bool IsMoveLegal(const Move& move) const;
   std::vector<Move> GetLegalMoves() const;
   void Play(const Move& move);
+  /**
+   * Plays a move for Us without any check, for callers that already know
+   * whose turn it is and only generate legal moves, like the search
+   *
+   * @param move a legal move, Us must be the current player
+   */
+  template <PlayerSymbol Us>
+  void Play(const Move& move);
+  /**
+   * Plays a move without any check like Play<Us>, but looks up the
+   * current player at run time. dispatchbench compares the two
+   *
+   * @param move a legal move
+   */
+  void PlayDynamic(const Move& move);
   PlayerSymbol GetCurrentPlayer() const { return m_currentPlayer; }
-  PlayerSymbol GetOtherPlayer() const {
-    return static_cast<PlayerSymbol>(-static_cast<int>(m_currentPlayer));
-  }
+  PlayerSymbol GetOtherPlayer() const { return Opponent(m_currentPlayer); }
   inline GameStatus GetTopGameStatus() const { return m_topGameStatus; }
   inline std::optional<Move> GetLastMove() const { return m_lastMove; }
+  // the sub board the current player has to play in, -1 if they can play in any board
+  int GetForcedBoard() const;
+
+  // the 8 symmetries of the square, applied to the big board and to every sub board
+  static constexpr int s_symmetryCount = 8;
+  /**
+   * Zobrist key of the position: the pieces, the player to move and the
+   * forced board. The keys are the same on every platform and build
+   */
+  uint64_t GetKey() const { return m_key ^ s_forcedBoardKeys[GetForcedBoard() + 1]; }
+  // key of the position transformed by a symmetry, computed from scratch
+  uint64_t GetKey(int symmetry) const;
+  static Move TransformMove(const Move& move, int symmetry);
+  static Move InverseTransformMove(const Move& move, int symmetry);
 
   inline bool IsGameOver() const {
     return m_topGameStatus != GameStatus::InProgress;
@@ -63,25 +142,44 @@ public:
   std::array<GameStatus, 9> GetBigBoard() const { return m_bigBoard; }
   inline Piece GetPieceAt(int board, int cell) const { return m_board[board * 9 + cell]; }
   inline Piece GetPieceAtRowCol(int row, int col) const { return m_board[s_boardIndexConversion[row * 9 + col]]; }
+  // the cells of a sub board occupied by a player, bit i is cell i
+  inline uint16_t GetCellMask(PlayerSymbol player, int board) const { return m_cellMasks[SideIndex(player)][board]; }
 
 private:
+  static constexpr int SideIndex(PlayerSymbol player) { return player == PlayerSymbol::X ? 0 : 1; }
+
   // Get the game status for the entire board
-  GameStatus CalcGameStatus(PlayerSymbol currentPlayer) const;
+  GameStatus CalcGameStatus() const;
   // Get the game status for a specific sub board
-  GameStatus CalcGameStatus(PlayerSymbol currentPlayer, int boardPosition) const;
-  GameStatus GetGameStatus_IMPL(PlayerSymbol currentPlayer, const Piece* board) const;
+  GameStatus CalcGameStatus(int boardPosition) const;
+  // the same for PlayDynamic, only checking the lines of the player who just moved
+  GameStatus CalcGameStatus(PlayerSymbol player) const;
+  GameStatus CalcGameStatus(PlayerSymbol player, int boardPosition) const;
+  void SetBoardStatus(int boardPosition, GameStatus status);
+  /**
+   * Fills in everything else once m_cellMasks holds the pieces
+   *
+   * @return the number of pieces of each player, X first
+   */
+  std::array<int, 2> InitFromCellMasks(PlayerSymbol currentPlayer, std::optional<Move> lastMove);
 
-  bool IsBoardFull(int boardPosition) const;
   void PrintPiece(std::ostream& os, int row, int col) const;
 
   std::array<Piece, 9 * 9> m_board = {Piece::Empty};
   std::array<GameStatus, 9> m_bigBoard = {GameStatus::InProgress};
+  // the same information as bit masks, X first: pieces of each sub board,
+  // sub boards won by each player and sub boards that are finished
+  std::array<std::array<uint16_t, 9>, 2> m_cellMasks = {};
+  std::array<uint16_t, 2> m_wonBoards = {};
+  uint16_t m_closedBoards = 0;
   GameStatus m_topGameStatus = GameStatus::InProgress;
 
   PlayerSymbol m_currentPlayer = PlayerSymbol::X;
   std::optional<Move> m_lastMove;
+  // key of the pieces and the player to move, see GetKey
+  uint64_t m_key = 0;
 
-  static const std::array<std::array<int, 3>, 8> s_indices;
+  static const std::array<uint64_t, 10> s_forcedBoardKeys;
 };
 
 // make the Board hashable
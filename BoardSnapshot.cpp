@@ -0,0 +1,30 @@
+#include "pch.h"
+#include "BoardSnapshot.h"
+
+BoardSnapshot::BoardSnapshot(const Board& board) {
+  for (int idx = 0; idx < 9 * 9; idx++)
+    m_pieces[idx] = static_cast<int8_t>(board.GetPieceAt(idx / 9, idx % 9));
+
+  const std::array<GameStatus, 9> bigBoard = board.GetBigBoard();
+  for (int i = 0; i < 9; i++)
+    m_bigBoard[i] = static_cast<int8_t>(bigBoard[i]);
+
+  m_topGameStatus = static_cast<int8_t>(board.GetTopGameStatus());
+  m_currentPlayer = static_cast<int8_t>(board.GetCurrentPlayer());
+
+  if (std::optional<Move> lastMove = board.GetLastMove())
+    m_lastMoveIdx = static_cast<int8_t>(lastMove->m_boardPosition * 9 + lastMove->m_cellPosition);
+
+  // precompute the playable boards once here so the
+  // renderer does not have to generate the legal moves
+  if (board.IsGameOver())
+    return;
+  for (int boardPosition = 0; boardPosition < 9; boardPosition++) {
+    for (int cellPosition = 0; cellPosition < 9; cellPosition++) {
+      if (board.IsMoveLegal(Move(boardPosition, cellPosition))) {
+        m_legalBoards |= 1 << boardPosition;
+        break;
+      }
+    }
+  }
+}
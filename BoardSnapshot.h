@@ -0,0 +1,50 @@
+#pragma once
+#include "Board.h"
+
+/**
+ * Immutable, compact copy of everything the renderer needs from a Board.
+ * Built by the game thread after every move and handed to the render
+ * thread through a TripleBuffer so the two never share a live Board.
+ */
+class BoardSnapshot {
+public:
+  BoardSnapshot() = default;
+  explicit BoardSnapshot(const Board& board);
+
+  inline Piece GetPieceAt(int board, int cell) const {
+    return static_cast<Piece>(m_pieces[board * 9 + cell]);
+  }
+  inline Piece GetPieceAtRowCol(int row, int col) const {
+    return static_cast<Piece>(m_pieces[s_boardIndexConversion[row * 9 + col]]);
+  }
+  inline GameStatus GetBigBoardStatus(int boardPosition) const {
+    return static_cast<GameStatus>(m_bigBoard[boardPosition]);
+  }
+  inline GameStatus GetTopGameStatus() const { return static_cast<GameStatus>(m_topGameStatus); }
+  inline bool IsGameOver() const { return GetTopGameStatus() != GameStatus::InProgress; }
+  inline PlayerSymbol GetCurrentPlayer() const { return static_cast<PlayerSymbol>(m_currentPlayer); }
+
+  std::optional<Move> GetLastMove() const {
+    if (m_lastMoveIdx < 0)
+      return std::nullopt;
+    return ConvertIdxToMove(m_lastMoveIdx);
+  }
+
+  /**
+   * @param boardPosition the position of the sub board
+   * @return true if the current player has at least one legal move in that board
+   */
+  inline bool IsBoardPlayable(int boardPosition) const {
+    return m_legalBoards & (1 << boardPosition);
+  }
+
+private:
+  std::array<int8_t, 9 * 9> m_pieces = {0};
+  std::array<int8_t, 9> m_bigBoard = {0};
+  int8_t m_topGameStatus = 0;
+  int8_t m_currentPlayer = static_cast<int8_t>(PlayerSymbol::X);
+  // index of the last move in the same layout as m_pieces, -1 if none
+  int8_t m_lastMoveIdx = -1;
+  // one bit per sub board that holds at least one legal move
+  uint16_t m_legalBoards = 0;
+};
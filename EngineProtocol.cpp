@@ -0,0 +1,168 @@
+#include "pch.h"
+#include "EngineProtocol.h"
+
+EngineProtocol::EngineProtocol(Output output)
+    : m_output(std::move(output)), m_player(std::make_unique<AIPlayer>(m_config)) {}
+
+EngineProtocol::~EngineProtocol() {
+  StopSearch();
+}
+
+Move EngineProtocol::ParseMove(std::string_view move) {
+  if (move.size() != 2 || move[0] < '0' || move[0] > '8' || move[1] < '0' || move[1] > '8')
+    throw std::invalid_argument(fmt::format("Expected a board and a cell, e.g. 40: {}", move));
+  return Move(move[0] - '0', move[1] - '0');
+}
+
+std::string EngineProtocol::FormatMove(const Move& move) {
+  return fmt::format("{}{}", move.m_boardPosition, move.m_cellPosition);
+}
+
+bool EngineProtocol::HandleLine(const std::string& line) {
+  std::istringstream args(line);
+  std::string command;
+  if (!(args >> command))
+    return true;
+
+  try {
+    if (command == "quit") {
+      StopSearch();
+      return false;
+    } else if (command == "isready") {
+      Write("readyok");
+    } else if (command == "stop") {
+      StopSearch();
+    } else if (command == "setoption") {
+      std::string config;
+      std::getline(args >> std::ws, config);
+      AIConfig parsed = AIConfig::Parse(config);
+      StopSearch();
+      m_config = parsed;
+      m_player = std::make_unique<AIPlayer>(m_config);
+    } else if (command == "newgame") {
+      StopSearch();
+      m_player->Reset();
+      m_board = Board();
+    } else if (command == "position") {
+      SetPosition(args);
+    } else if (command == "go") {
+      Go(args);
+    } else {
+      throw std::invalid_argument("Unknown command " + command);
+    }
+  } catch (const std::exception& e) {
+    Write(fmt::format("info string error: {}", e.what()));
+  }
+  return true;
+}
+
+void EngineProtocol::SetPosition(std::istringstream& args) {
+  std::string token;
+  std::string notation;
+  while (args >> token && token != "moves") {
+    if (!notation.empty())
+      notation += ' ';
+    notation += token;
+  }
+
+  Board board = notation == "startpos" ? Board() : Board::FromNotation(notation);
+  while (args >> token) {
+    Move move = ParseMove(token);
+    if (board.IsGameOver() || !board.IsMoveLegal(move))
+      throw std::invalid_argument(fmt::format("Illegal move {} in {}", token, board.ToNotation()));
+    board.Play(move);
+  }
+  // a search of the previous position answers before the new one is set
+  StopSearch();
+  m_board = board;
+}
+
+void EngineProtocol::Go(std::istringstream& args) {
+  SearchLimits limits;
+  // multipv and depth leave the depth to the configuration or set it themselves
+  bool isPlain = true;
+  bool isInfinite = false;
+  std::string token;
+  while (args >> token) {
+    if (token == "infinite") {
+      isInfinite = true;
+      isPlain = false;
+      continue;
+    }
+    std::string value;
+    if (!(args >> value))
+      throw std::invalid_argument("Missing value for " + token);
+    if (token == "depth") {
+      // in plies from the root, as reported by info depth
+      int depth = std::stoi(value);
+      if (depth < 1 || depth > 81)
+        throw std::invalid_argument("Invalid depth: " + value);
+      limits.depth = depth - 1;
+    } else if (token == "movetime") {
+      limits.time = std::chrono::milliseconds(std::max(1ll, std::stoll(value)));
+      isPlain = false;
+    } else if (token == "nodes") {
+      limits.nodes = std::stoull(value);
+      isPlain = false;
+    } else if (token == "multipv") {
+      limits.multiPv = std::stoi(value);
+      if (limits.multiPv < 1 || limits.multiPv > 81)
+        throw std::invalid_argument("Invalid multipv: " + value);
+    } else {
+      throw std::invalid_argument("Unknown go option " + token);
+    }
+  }
+  // only a go without a time or node limit searches to the configured depth, the others
+  // go as deep as their limits allow, until stop for infinite. No game lasts longer than this
+  if (limits.depth < 0 && !isPlain)
+    limits.depth = 80;
+
+  StopSearch();
+  m_stop = false;
+  m_isInfinite = isInfinite;
+  limits.stop = &m_stop;
+  m_searchThread = std::thread([this, board = m_board, limits] {
+    std::optional<SearchResult> result = m_player->Analyze(board, limits, [this](const SearchResult& iteration) {
+      const SearchStats& stats = iteration.stats;
+      for (std::size_t i = 0; i < iteration.lines.size(); i++) {
+        const PvLine& line = iteration.lines[i];
+        std::string pv;
+        for (const Move& move : line.pv) {
+          // not " " + FormatMove(move), GCC 12 warns about that temporary
+          pv += ' ';
+          pv += FormatMove(move);
+        }
+        std::string multiPv = iteration.lines.size() > 1 ? fmt::format(" multipv {}", i + 1) : "";
+        Write(fmt::format("info depth {}{} score {} nodes {} time {} nps {:.0f} pv{}", stats.depth, multiPv,
+                          line.score, stats.nodes,
+                          std::chrono::duration_cast<std::chrono::milliseconds>(stats.elapsed).count(),
+                          stats.NodesPerSecond(), pv));
+      }
+    });
+    if (!result) {
+      Write("info string error: the game is over");
+      Write("bestmove none");
+      return;
+    }
+    Write("bestmove " + FormatMove(result->move));
+  });
+}
+
+void EngineProtocol::StopSearch() {
+  if (!m_searchThread.joinable())
+    return;
+  m_stop = true;
+  m_searchThread.join();
+}
+
+void EngineProtocol::WaitForSearch() {
+  if (m_isInfinite)
+    StopSearch();
+  else if (m_searchThread.joinable())
+    m_searchThread.join();
+}
+
+void EngineProtocol::Write(const std::string& line) {
+  std::lock_guard<std::mutex> lock(m_outputMutex);
+  m_output(line);
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "players/AIPlayer.h"
+
+/**
+ * Line based text protocol to drive the engine from another program,
+ * modelled on UCI. Commands, one per line:
+ *
+ *   isready                                answers readyok
+ *   setoption <engine config>              e.g. setoption depth=8,lmr=0
+ *   newgame                                forgets what was learned in previous positions
+ *   position startpos|<notation> [moves <move>...]
+ *   go [depth n] [movetime ms] [nodes n] [multipv k] [infinite]
+ *   stop                                   ends the search, which still answers bestmove
+ *   quit
+ *
+ * Moves are written as their board and cell, e.g. 40 for the top left
+ * cell of the center board, and positions in the one line notation of
+ * Board::ToNotation. The search runs on its own thread and writes
+ *
+ *   info depth 7 score 12 nodes 50211 time 28 nps 1768000 pv 40 04 44
+ *
+ * after every iteration and bestmove 40 once it is done, so stop and
+ * isready are answered while it runs. With multipv k > 1 every iteration
+ * writes k info lines, with multipv 1..k after the depth. Anything invalid
+ * is answered with info string error: followed by the reason.
+ */
+class EngineProtocol {
+public:
+  // receives every output line without its line break, from any thread but never concurrently
+  using Output = std::function<void(const std::string&)>;
+
+  explicit EngineProtocol(Output output);
+  ~EngineProtocol();
+
+  EngineProtocol(const EngineProtocol&) = delete;
+  EngineProtocol& operator=(const EngineProtocol&) = delete;
+
+  /**
+   * Runs a command, a search is started and left running in the background
+   *
+   * @return false once the command was quit
+   */
+  bool HandleLine(const std::string& line);
+  // lets the running search finish, at the end of the input. An infinite one is stopped
+  void WaitForSearch();
+
+  /**
+   * @throws std::invalid_argument if move is not a board and a cell
+   */
+  static Move ParseMove(std::string_view move);
+  static std::string FormatMove(const Move& move);
+
+private:
+  void SetPosition(std::istringstream& args);
+  void Go(std::istringstream& args);
+  // stops the running search and waits for its bestmove
+  void StopSearch();
+  void Write(const std::string& line);
+
+  Output m_output;
+  std::mutex m_outputMutex;
+  AIConfig m_config;
+  std::unique_ptr<AIPlayer> m_player;
+  Board m_board;
+  std::thread m_searchThread;
+  std::atomic<bool> m_stop = false;
+  bool m_isInfinite = false;
+};
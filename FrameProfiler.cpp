@@ -0,0 +1,149 @@
+#include "pch.h"
+#include "FrameProfiler.h"
+
+// the timer queries are not in the OpenGL 1.1 headers every platform has,
+// so they are loaded at run time
+#ifdef _WIN32
+#define ETTT_GL_API __stdcall
+#else
+#define ETTT_GL_API
+#endif
+
+using GenQueriesFn = void(ETTT_GL_API*)(GLsizei, GLuint*);
+using DeleteQueriesFn = void(ETTT_GL_API*)(GLsizei, const GLuint*);
+using BeginQueryFn = void(ETTT_GL_API*)(GLenum, GLuint);
+using EndQueryFn = void(ETTT_GL_API*)(GLenum);
+using GetQueryObjectuivFn = void(ETTT_GL_API*)(GLuint, GLenum, GLuint*);
+using GetQueryObjectui64vFn = void(ETTT_GL_API*)(GLuint, GLenum, uint64_t*);
+
+static constexpr GLenum s_timeElapsed = 0x88BF;
+static constexpr GLenum s_queryResult = 0x8866;
+static constexpr GLenum s_queryResultAvailable = 0x8867;
+
+// only the render thread uses them, with the single context of the game
+static GenQueriesFn s_genQueries = nullptr;
+static DeleteQueriesFn s_deleteQueries = nullptr;
+static BeginQueryFn s_beginQuery = nullptr;
+static EndQueryFn s_endQuery = nullptr;
+static GetQueryObjectuivFn s_getQueryObjectuiv = nullptr;
+static GetQueryObjectui64vFn s_getQueryObjectui64v = nullptr;
+
+template <typename Fn>
+static Fn LoadFunction(const char* name, const char* fallback = nullptr) {
+  GLFWglproc proc = glfwGetProcAddress(name);
+  if (!proc && fallback)
+    proc = glfwGetProcAddress(fallback);
+  return reinterpret_cast<Fn>(proc);
+}
+
+static float ToMilliseconds(std::chrono::nanoseconds duration) {
+  return std::chrono::duration<float, std::milli>(duration).count();
+}
+
+double FrameProfiler::Report::GetFramesPerSecond() const {
+  double seconds = std::chrono::duration<double>(period).count();
+  return seconds > 0 ? frames / seconds : 0;
+}
+
+FrameProfiler::FrameProfiler() {
+  if (glfwExtensionSupported("GL_ARB_timer_query") || glfwExtensionSupported("GL_EXT_timer_query")) {
+    s_genQueries = LoadFunction<GenQueriesFn>("glGenQueries", "glGenQueriesARB");
+    s_deleteQueries = LoadFunction<DeleteQueriesFn>("glDeleteQueries", "glDeleteQueriesARB");
+    s_beginQuery = LoadFunction<BeginQueryFn>("glBeginQuery", "glBeginQueryARB");
+    s_endQuery = LoadFunction<EndQueryFn>("glEndQuery", "glEndQueryARB");
+    s_getQueryObjectuiv = LoadFunction<GetQueryObjectuivFn>("glGetQueryObjectuiv", "glGetQueryObjectuivARB");
+    s_getQueryObjectui64v = LoadFunction<GetQueryObjectui64vFn>("glGetQueryObjectui64v", "glGetQueryObjectui64vEXT");
+    m_hasGpuTimer = s_genQueries && s_deleteQueries && s_beginQuery && s_endQuery && s_getQueryObjectuiv &&
+                    s_getQueryObjectui64v;
+  }
+  if (m_hasGpuTimer) {
+    for (Query& query : m_queries)
+      s_genQueries(1, &query.id);
+  } else {
+    SPDLOG_INFO("No GPU timer queries, frames are only timed on the CPU");
+  }
+  m_reportStart = std::chrono::steady_clock::now();
+}
+
+FrameProfiler::~FrameProfiler() {
+  if (!m_hasGpuTimer)
+    return;
+  for (Query& query : m_queries)
+    s_deleteQueries(1, &query.id);
+}
+
+void FrameProfiler::BeginFrame() {
+  m_frameStart = std::chrono::steady_clock::now();
+  if (m_lastFrameStart)
+    m_current.interval.Record(m_frameStart - *m_lastFrameStart);
+  m_lastFrameStart = m_frameStart;
+
+  if (!m_hasGpuTimer)
+    return;
+  CollectQueries();
+  Query& query = m_queries[m_nextQuery];
+  // the GPU is more than s_queryCount frames behind, this frame goes untimed
+  if (query.isPending)
+    return;
+  m_nextQuery = (m_nextQuery + 1) % s_queryCount;
+  query.isPending = true;
+  query.historySlot = m_historyNext;
+  s_beginQuery(s_timeElapsed, query.id);
+  m_activeQuery = &query;
+}
+
+bool FrameProfiler::EndFrame(uint32_t drawCalls, uint32_t vertices) {
+  const auto end = std::chrono::steady_clock::now();
+  if (m_activeQuery) {
+    s_endQuery(s_timeElapsed);
+    m_activeQuery = nullptr;
+  }
+
+  m_current.cpu.Record(end - m_frameStart);
+  m_current.frames++;
+  m_current.drawCalls += drawCalls;
+  m_current.vertices += vertices;
+  m_cpuHistory[m_historyNext] = ToMilliseconds(end - m_frameStart);
+  // filled in once the query of the frame is read back
+  m_gpuHistory[m_historyNext] = 0;
+  m_historyNext = (m_historyNext + 1) % s_historySize;
+
+  if (end - m_reportStart < s_reportPeriod)
+    return false;
+  m_current.period = end - m_reportStart;
+  m_report = std::move(m_current);
+  m_current = Report();
+  m_reportStart = end;
+  return true;
+}
+
+void FrameProfiler::CollectQueries() {
+  for (Query& query : m_queries) {
+    if (!query.isPending)
+      continue;
+    GLuint isAvailable = 0;
+    s_getQueryObjectuiv(query.id, s_queryResultAvailable, &isAvailable);
+    if (!isAvailable)
+      continue;
+    uint64_t ns = 0;
+    s_getQueryObjectui64v(query.id, s_queryResult, &ns);
+    query.isPending = false;
+    // frames drawn after the end of their report count in the next one
+    m_current.gpu.Record(std::chrono::nanoseconds(ns));
+    m_gpuHistory[query.historySlot] = ToMilliseconds(std::chrono::nanoseconds(ns));
+  }
+}
+
+std::ostream& operator<<(std::ostream& out, const FrameProfiler::Report& report) {
+  double frames = std::max(report.frames, 1);
+  std::ostringstream os;
+  os << std::fixed << std::setprecision(1)
+     << "fps=" << report.GetFramesPerSecond()
+     << " draw_calls=" << report.drawCalls / frames
+     << " vertices=" << report.vertices / frames
+     << " cpu=[" << report.cpu << "]";
+  if (report.gpu.GetCount())
+    os << " gpu=[" << report.gpu << "]";
+  os << " interval=[" << report.interval << "]";
+  return out << os.str();
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include "LatencyHistogram.h"
+
+/**
+ * Measures the cost of every frame of the render thread: the CPU time
+ * spent building it, the GPU time spent drawing it, the time between
+ * frames and the draw calls and vertices it sent.
+ *
+ * GPU times come from timer queries, read a few frames later so the CPU
+ * never waits on the GPU. They are left out when the driver has no timer
+ * queries. The frames are summed up in a report every second.
+ *
+ * Only the render thread uses it, with its context current.
+ */
+class FrameProfiler {
+public:
+  // frames kept for the frame time graph
+  static constexpr int s_historySize = 120;
+
+  struct Report {
+    int frames = 0;
+    std::chrono::nanoseconds period{0};
+    LatencyHistogram cpu;
+    LatencyHistogram gpu;
+    LatencyHistogram interval;
+    uint64_t drawCalls = 0;
+    uint64_t vertices = 0;
+
+    double GetFramesPerSecond() const;
+  };
+
+  // loads the timer query functions of the current context
+  FrameProfiler();
+  ~FrameProfiler();
+  FrameProfiler(const FrameProfiler&) = delete;
+  FrameProfiler& operator=(const FrameProfiler&) = delete;
+
+  bool HasGpuTimer() const { return m_hasGpuTimer; }
+
+  void BeginFrame();
+  /**
+   * Call before swapping the buffers, which waits for vsync
+   *
+   * @param drawCalls draw calls sent since BeginFrame
+   * @param vertices vertices sent since BeginFrame
+   * @return true if a report was completed with this frame
+   */
+  bool EndFrame(uint32_t drawCalls, uint32_t vertices);
+
+  // the last complete report
+  const Report& GetReport() const { return m_report; }
+
+  /**
+   * @param index 0 for the oldest frame kept, s_historySize - 1 for the last one
+   * @return the CPU and GPU time of a frame in ms, 0 when unknown
+   */
+  float GetCpuHistory(int index) const { return m_cpuHistory[(m_historyNext + index) % s_historySize]; }
+  float GetGpuHistory(int index) const { return m_gpuHistory[(m_historyNext + index) % s_historySize]; }
+
+private:
+  // queries in flight, a result is read back this many frames later at worst
+  static constexpr int s_queryCount = 4;
+  static constexpr std::chrono::seconds s_reportPeriod{1};
+
+  struct Query {
+    unsigned int id = 0;
+    bool isPending = false;
+    // history slot of the frame it measures
+    int historySlot = 0;
+  };
+
+  // reads back the finished queries without waiting for the others
+  void CollectQueries();
+
+  bool m_hasGpuTimer = false;
+  std::array<Query, s_queryCount> m_queries;
+  Query* m_activeQuery = nullptr;
+  int m_nextQuery = 0;
+
+  std::chrono::steady_clock::time_point m_frameStart;
+  std::optional<std::chrono::steady_clock::time_point> m_lastFrameStart;
+  std::chrono::steady_clock::time_point m_reportStart;
+
+  Report m_current;
+  Report m_report;
+
+  std::array<float, s_historySize> m_cpuHistory = {0};
+  std::array<float, s_historySize> m_gpuHistory = {0};
+  int m_historyNext = 0;
+};
+
+/**
+ * Writes fps, the CPU, GPU and interval histograms and the average
+ * draw calls and vertices per frame, as space separated key=value pairs
+ */
+std::ostream& operator<<(std::ostream& os, const FrameProfiler::Report& report);
+template <>
+struct fmt::formatter<FrameProfiler::Report> : fmt::ostream_formatter {};
@@ -1,6 +1,11 @@
 #include "pch.h"
 #include "Game.h"
+#include "FrameProfiler.h"
+#include "Logging.h"
 #include "Rendering.h"
+#include "Trace.h"
+
+static const char* s_windowTitle = "TicTacToe";
 
 void Game::OnKeyPress(GLFWwindow*, int key, int scancode, int action, [[maybe_unused]] int mods) {
   [[maybe_unused]] const char* keyName = glfwGetKeyName(key, scancode);
@@ -10,6 +15,9 @@ void Game::OnKeyPress(GLFWwindow*, int key, int scancode, int action, [[maybe_un
     m_isPaused = !m_isPaused;
     m_pauseCondVar.notify_one();
     SPDLOG_INFO("Game is {}", m_isPaused ? "paused" : "running");
+  } else if (key == GLFW_KEY_F3 && action == GLFW_PRESS) {
+    m_showFrameStats = !m_showFrameStats;
+    SPDLOG_INFO("Frame stats are {}", m_showFrameStats ? "shown" : "hidden");
   }
 }
 
@@ -29,7 +37,7 @@ void Game::InitGLFW() {
 void Game::CreateGLFWWindow() {
   glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
   m_window = glfwCreateWindow(
-      m_windowWidth, m_windowHeight, "TicTacToe", nullptr, nullptr);
+      m_windowWidth, m_windowHeight, s_windowTitle, nullptr, nullptr);
 
   if (!m_window) {
     const char* error;
@@ -71,7 +79,7 @@ void Game::InitCallbacks() {
     double ry = y / game->m_windowHeight;
 
     // only propagate the event to the correct player
-    if (game->m_board.GetCurrentPlayer() == PlayerSymbol::X)
+    if (game->m_currentPlayer == PlayerSymbol::X)
       game->m_playerX->OnMouseButtonEvent(rx, ry);
     else
       game->m_playerO->OnMouseButtonEvent(rx, ry);
@@ -117,6 +125,7 @@ GameStatus Game::RunGUI() {
   std::thread gameThread(&Game::GameLoop, this);
   while (!glfwWindowShouldClose(m_window)) {
     glfwWaitEvents();
+    UpdateWindowTitle();
   }
   m_gameShouldClose = true;
   m_playerX->Terminate();
@@ -128,6 +137,14 @@ GameStatus Game::RunGUI() {
   gameThread.join();
   SPDLOG_TRACE("Game thread joined");
 
+  return GetResult();
+}
+
+GameStatus Game::GetResult() const {
+  if (m_clock) {
+    if (std::optional<PlayerSymbol> flagged = m_clock->GetFlagged())
+      return *flagged == PlayerSymbol::X ? GameStatus::OWins : GameStatus::XWins;
+  }
   return m_board.GetTopGameStatus();
 }
 
@@ -162,12 +179,35 @@ void Game::SetBackgroundColor() {
   glClearColor(r, g, b, 1.0f);
 }
 
+// the window title with the averages and the p99 of a frame report
+static std::string FormatFrameTitle(const FrameProfiler::Report& report) {
+  auto ms = [](std::chrono::nanoseconds duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  };
+  std::string gpu;
+  if (report.gpu.GetCount())
+    gpu = fmt::format(" | gpu {:.2f} ms p99 {:.2f}", ms(report.gpu.GetMean()), ms(report.gpu.GetPercentile(0.99)));
+  const uint64_t frames = std::max(report.frames, 1);
+  return fmt::format("{} | {:.0f} fps | cpu {:.2f} ms p99 {:.2f}{} | {} draws {} vertices", s_windowTitle,
+                     report.GetFramesPerSecond(), ms(report.cpu.GetMean()), ms(report.cpu.GetPercentile(0.99)), gpu,
+                     report.drawCalls / frames, report.vertices / frames);
+}
+
 void Game::RenderLoop() {
+  TRACE_THREAD_NAME("render");
   // make sure the context is current on this thread
   glfwMakeContextCurrent(m_window);
 
   SetBackgroundColor();
+  auto profiler = std::make_unique<FrameProfiler>();
+  bool wereStatsShown = false;
   while (!glfwWindowShouldClose(m_window)) {
+    TRACE_SCOPE("Game::RenderLoop frame");
+    profiler->BeginFrame();
+    s_drawCounters = DrawCounters();
+    // never blocks, the game thread may publish a newer board meanwhile
+    const BoardSnapshot& board = m_snapshots.Read();
+
     glClear(GL_COLOR_BUFFER_BIT);
     // on resize events
     if (m_viewportNeedsUpdate) {
@@ -177,22 +217,59 @@ void Game::RenderLoop() {
 
     RenderSmallBoards();
     RenderBigBoard();
-    RenderSmallPieces();
-    RenderBigPieces();
-
-    if (!m_board.IsGameOver())
-      RenderLegalMoves();
+    RenderSmallPieces(board);
+    RenderBigPieces(board);
+
+    if (!board.IsGameOver())
+      RenderLegalMoves(board);
+
+    const bool showStats = m_showFrameStats;
+    if (showStats)
+      RenderFrameGraph(*profiler);
+    if (profiler->EndFrame(s_drawCounters.drawCalls, s_drawCounters.vertices)) {
+      const FrameProfiler::Report& report = profiler->GetReport();
+      if (showStats) {
+        SPDLOG_INFO("Frames: {}", report);
+        SetWindowTitle(FormatFrameTitle(report));
+      } else if (spdlog::should_log(spdlog::level::debug)) {
+        SPDLOG_DEBUG("Frames: {}", report);
+      }
+    }
+    if (wereStatsShown && !showStats)
+      SetWindowTitle(s_windowTitle);
+    wereStatsShown = showStats;
 
     glfwSwapBuffers(m_window);
   }
 
+  // its queries belong to the context
+  profiler.reset();
   glfwMakeContextCurrent(nullptr);
 }
 
-float Game::GetColorIntensity(Move move) {
-  GameStatus bigBoardStatus = m_board.GetBigBoard()[move.m_boardPosition];
+void Game::SetWindowTitle(std::string title) {
+  {
+    std::lock_guard<std::mutex> lock(m_titleMutex);
+    m_pendingTitle = std::move(title);
+  }
+  // glfwSetWindowTitle may only be called from the main thread
+  glfwPostEmptyEvent();
+}
 
-  if (move == m_board.GetLastMove())
+void Game::UpdateWindowTitle() {
+  std::optional<std::string> title;
+  {
+    std::lock_guard<std::mutex> lock(m_titleMutex);
+    title.swap(m_pendingTitle);
+  }
+  if (title)
+    glfwSetWindowTitle(m_window, title->c_str());
+}
+
+float Game::GetColorIntensity(const BoardSnapshot& board, Move move) {
+  GameStatus bigBoardStatus = board.GetBigBoardStatus(move.m_boardPosition);
+
+  if (move == board.GetLastMove())
     return 1.f;
   else if (bigBoardStatus != GameStatus::InProgress)
     return 0.2f;
@@ -200,35 +277,35 @@ float Game::GetColorIntensity(Move move) {
     return 0.5f;
 }
 
-void Game::RenderSinglePiece(int row, int col) {
-  const Piece piece = m_board.GetPieceAtRowCol(row, col);
+void Game::RenderSinglePiece(const BoardSnapshot& board, int row, int col) {
+  const Piece piece = board.GetPieceAtRowCol(row, col);
   // the board is rendered upside down
   int renderRow = 8 - row;
   int idx = s_boardIndexConversion[row * 9 + col];
   Move m = ConvertIdxToMove(idx);
 
   if (piece == Piece::X) {
-    GLfloat red[3] = {GetColorIntensity(m), 0.f, 0.f};
+    GLfloat red[3] = {GetColorIntensity(board, m), 0.f, 0.f};
     RenderX(renderRow, col, red);
   } else if (piece == Piece::O) {
-    GLfloat blue[3] = {0.f, 0.f, GetColorIntensity(m)};
+    GLfloat blue[3] = {0.f, 0.f, GetColorIntensity(board, m)};
     RenderO(renderRow, col, blue);
   }
 }
 
-void Game::RenderSmallPieces() {
+void Game::RenderSmallPieces(const BoardSnapshot& board) {
   const int boardSize = 9;
   glLoadIdentity();
   glOrtho(0, boardSize, 0, boardSize, -1, 1);
 
   for (int row = 0; row < boardSize; ++row) {
     for (int col = 0; col < boardSize; ++col) {
-      RenderSinglePiece(row, col);
+      RenderSinglePiece(board, row, col);
     }
   }
 }
 
-void Game::RenderBigPieces() {
+void Game::RenderBigPieces(const BoardSnapshot& board) {
   const int boardSize = 3;
   // we want the big pieces to be thicker than the small
   const float thickness = 7.f;
@@ -241,7 +318,7 @@ void Game::RenderBigPieces() {
   glOrtho(xOffset, boardSize + xOffset, yOffset, boardSize + yOffset, -1, 1);
   for (int row = 0; row < boardSize; ++row) {
     for (int col = 0; col < boardSize; ++col) {
-      const GameStatus status = m_board.GetBigBoard()[row * boardSize + col];
+      const GameStatus status = board.GetBigBoardStatus(row * boardSize + col);
       int renderRow = boardSize - 1 - row;
       if (status == GameStatus::XWins) {
         GLfloat red[3] = {0.6f, 0.f, 0.f};
@@ -254,25 +331,26 @@ void Game::RenderBigPieces() {
   }
 }
 
-void Game::RenderLegalMoves() {
-  std::vector<Move> moves = m_board.GetLegalMoves();
-  // make a vector of unique boardPositions from the moves vector
-  std::vector<int> bps;
-  for (const Move& move : moves)
-    if (std::find(bps.begin(), bps.end(), move.m_boardPosition) == bps.end())
-      bps.push_back(move.m_boardPosition);
-
+void Game::RenderLegalMoves(const BoardSnapshot& board) {
   glLoadIdentity();
   int boardSize = 9;
   glOrtho(0, boardSize, 0, boardSize, -1, 1);
-  for (int boardPosition : bps)
-    RenderBoardBorder(boardPosition);
+  for (int boardPosition = 0; boardPosition < 9; boardPosition++)
+    if (board.IsBoardPlayable(boardPosition))
+      RenderBoardBorder(boardPosition);
+}
+
+void Game::PublishBoard() {
+  m_snapshots.Publish(BoardSnapshot(m_board));
+  m_currentPlayer = m_board.GetCurrentPlayer();
 }
 
 GameStatus Game::GameLoop() {
+  TRACE_THREAD_NAME("game");
   SPDLOG_INFO("Running the game");
 
   while (!m_board.IsGameOver() && !m_gameShouldClose) {
+    TRACE_SCOPE("Game::GameLoop turn");
     // using namespace std::chrono_literals;
     // std::this_thread::sleep_for(100ms);
 
@@ -290,7 +368,18 @@ GameStatus Game::GameLoop() {
     SPDLOG_INFO("Waiting for a move");
     Move move;
     bool played = false;
-    move = currentPlayer->GetMove();
+    if (m_clock) {
+      currentPlayer->SetTimeLeft(m_clock->GetRemaining(ps), m_clock->GetControl().increment);
+      m_clock->Start(ps);
+    }
+    {
+      TRACE_SCOPE("Player::GetMove");
+      move = currentPlayer->GetMove();
+    }
+    if (m_clock && !m_clock->Stop()) {
+      SPDLOG_INFO("{} ran out of time", ps);
+      break;
+    }
     if (m_board.IsMoveLegal(move)) {
       otherPlayer->ReceiveMove(move);
       played = true;
@@ -299,9 +388,18 @@ GameStatus Game::GameLoop() {
     }
 
     if (played) {
-      SPDLOG_INFO("{} played {}", ps, move);
+      if (m_clock)
+        SPDLOG_INFO("{} played {}, {}ms left", ps, move, m_clock->GetRemaining(ps).count());
+      else
+        SPDLOG_INFO("{} played {}", ps, move);
+      if (spdlog::logger* events = Logging::GetEvents())
+        events->info(R"("event":"move","player":"{}","move":"{}{}","position":"{}")", ps, move.m_boardPosition,
+                     move.m_cellPosition, m_board.ToNotation());
       m_board.Play(move);
-      SPDLOG_DEBUG("New hash {}", std::hash<Board>{}(m_board));
+      PublishBoard();
+      // the arguments are computed even when the level is off
+      if (spdlog::should_log(spdlog::level::debug))
+        SPDLOG_DEBUG("New hash {}", std::hash<Board>{}(m_board));
     }
 
     std::unique_lock<std::mutex> pauseLock(m_PauseMutex);
@@ -310,6 +408,8 @@ GameStatus Game::GameLoop() {
     });
   }
 
-  SPDLOG_INFO("Game is over with status {}", m_board.GetTopGameStatus());
-  return m_board.GetTopGameStatus();
+  SPDLOG_INFO("Game is over with status {}", GetResult());
+  if (spdlog::logger* events = Logging::GetEvents())
+    events->info(R"("event":"result","status":"{}","position":"{}")", GetResult(), m_board.ToNotation());
+  return GetResult();
 }
@@ -1,4 +1,7 @@
 #pragma once
+#include "BoardSnapshot.h"
+#include "GameClock.h"
+#include "TripleBuffer.h"
 #include "players/Player.h"
 
 class Game {
@@ -8,12 +11,15 @@ public:
   ~Game();
 
   void RegisterPlayer(std::unique_ptr<Player> player);
+  // plays with a clock, a player running out of time loses
+  void SetTimeControl(const TimeControl& control) { m_clock = std::make_unique<GameClock>(control); }
   GameStatus RunGUI();
 
 private:
   void OnKeyPress(GLFWwindow* window, int key, int scancode, int action, int mods);
 
   void Init() {
+    PublishBoard();
     InitGLFW();
     CreateGLFWWindow();
     InitCallbacks();
@@ -23,19 +29,31 @@ private:
   void InitCallbacks();
 
   void RenderLoop();
+  // render thread: the main thread shows it once it handles its next events
+  void SetWindowTitle(std::string title);
+  // main thread
+  void UpdateWindowTitle();
   GameStatus GameLoop();
+  // the status of the board, unless a player lost on time
+  GameStatus GetResult() const;
+  void PublishBoard();
 
   void SetBackgroundColor();
-  float GetColorIntensity(Move move);
+  float GetColorIntensity(const BoardSnapshot& board, Move move);
 
-  void RenderSinglePiece(int row, int col);
-  void RenderSmallPieces();
-  void RenderBigPieces();
-  void RenderLegalMoves();
+  void RenderSinglePiece(const BoardSnapshot& board, int row, int col);
+  void RenderSmallPieces(const BoardSnapshot& board);
+  void RenderBigPieces(const BoardSnapshot& board);
+  void RenderLegalMoves(const BoardSnapshot& board);
 
+  // only ever touched by the game thread once the GUI is running,
+  // the other threads read the published snapshot or m_currentPlayer
   Board m_board;
+  TripleBuffer<BoardSnapshot> m_snapshots;
+  std::atomic<PlayerSymbol> m_currentPlayer = PlayerSymbol::X;
   std::unique_ptr<Player> m_playerX;
   std::unique_ptr<Player> m_playerO;
+  std::unique_ptr<GameClock> m_clock;
 
   // cant make this a unique_ptr
   // because not a complete type
@@ -47,8 +65,13 @@ private:
 
   std::atomic<bool> m_gameShouldClose = false;
 
-  int m_windowWidth = 640;
-  int m_windowHeight = 480;
+  // frame times graph, with the frame costs in the title and the log
+  std::atomic<bool> m_showFrameStats = false;
+  std::mutex m_titleMutex;
+  std::optional<std::string> m_pendingTitle;
+
+  std::atomic<int> m_windowWidth = 640;
+  std::atomic<int> m_windowHeight = 480;
   std::atomic<bool> m_viewportNeedsUpdate{false};
 
   const std::array<float, 3> m_BackgroundColor = {0.0f, 0.1f, 0.1f};
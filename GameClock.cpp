@@ -0,0 +1,69 @@
+#include "pch.h"
+#include "GameClock.h"
+
+static std::chrono::milliseconds ParseSeconds(const std::string& str) {
+  std::size_t end = 0;
+  double seconds = std::stod(str, &end);
+  if (end != str.size() || seconds < 0)
+    throw std::invalid_argument("Invalid time: " + str);
+  return std::chrono::milliseconds(static_cast<int64_t>(std::llround(seconds * 1000)));
+}
+
+static std::size_t ClockIndex(PlayerSymbol player) { return player == PlayerSymbol::X ? 0 : 1; }
+
+TimeControl TimeControl::Parse(const std::string& str) {
+  TimeControl control;
+  std::size_t plus = str.find('+');
+  try {
+    control.base = ParseSeconds(str.substr(0, plus));
+    if (plus != std::string::npos)
+      control.increment = ParseSeconds(str.substr(plus + 1));
+  } catch (const std::logic_error&) {
+    throw std::invalid_argument("Expected base+increment in seconds, e.g. 60+0.5: " + str);
+  }
+  if (control.base.count() <= 0)
+    throw std::invalid_argument("The base time must be positive: " + str);
+  return control;
+}
+
+std::ostream& operator<<(std::ostream& os, const TimeControl& control) {
+  return os << control.base.count() / 1000.0 << "+" << control.increment.count() / 1000.0;
+}
+
+GameClock::GameClock(const TimeControl& control)
+    : m_control(control), m_remaining{control.base, control.base} {}
+
+void GameClock::Start(PlayerSymbol player) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_running = player;
+  m_start = std::chrono::steady_clock::now();
+}
+
+bool GameClock::Stop() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_running)
+    return true;
+  auto& remaining = m_remaining[ClockIndex(*m_running)];
+  remaining -= std::chrono::steady_clock::now() - m_start;
+  PlayerSymbol player = *std::exchange(m_running, std::nullopt);
+  if (remaining <= std::chrono::steady_clock::duration::zero()) {
+    remaining = std::chrono::steady_clock::duration::zero();
+    m_flagged = player;
+    return false;
+  }
+  remaining += m_control.increment;
+  return true;
+}
+
+std::chrono::milliseconds GameClock::GetRemaining(PlayerSymbol player) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto remaining = m_remaining[ClockIndex(player)];
+  if (m_running == player)
+    remaining -= std::chrono::steady_clock::now() - m_start;
+  return std::max(std::chrono::duration_cast<std::chrono::milliseconds>(remaining), std::chrono::milliseconds(0));
+}
+
+std::optional<PlayerSymbol> GameClock::GetFlagged() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_flagged;
+}
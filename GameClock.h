@@ -0,0 +1,56 @@
+#pragma once
+#include "Board.h"
+
+/**
+ * Time each player gets for the whole game, and the time added
+ * to their clock after each of their moves
+ */
+struct TimeControl {
+  std::chrono::milliseconds base{0};
+  std::chrono::milliseconds increment{0};
+
+  /**
+   * Parses base+increment in seconds, e.g. 60+0.5, the increment is optional
+   *
+   * @throws std::invalid_argument if str is not in this format
+   */
+  static TimeControl Parse(const std::string& str);
+};
+
+std::ostream& operator<<(std::ostream& os, const TimeControl& control);
+template <>
+struct fmt::formatter<TimeControl> : fmt::ostream_formatter {};
+
+/**
+ * Chess clock of a game, with one clock per player of which at most one
+ * runs. A player whose time runs out during a move is flagged, they lose
+ * the game once the move is over. Safe to read from other threads, e.g.
+ * to display the times.
+ */
+class GameClock {
+public:
+  explicit GameClock(const TimeControl& control);
+
+  // starts the clock of player, whose turn it is
+  void Start(PlayerSymbol player);
+  /**
+   * Stops the running clock and adds the increment to it,
+   * unless the player ran out of time
+   *
+   * @return false if the player ran out of time, it is then flagged
+   */
+  bool Stop();
+
+  // time left to player, the running clock included
+  std::chrono::milliseconds GetRemaining(PlayerSymbol player) const;
+  const TimeControl& GetControl() const { return m_control; }
+  std::optional<PlayerSymbol> GetFlagged() const;
+
+private:
+  const TimeControl m_control;
+  mutable std::mutex m_mutex;
+  std::array<std::chrono::steady_clock::duration, 2> m_remaining;
+  std::optional<PlayerSymbol> m_running;
+  std::chrono::steady_clock::time_point m_start;
+  std::optional<PlayerSymbol> m_flagged;
+};
@@ -0,0 +1,286 @@
+#include "pch.h"
+#include "GameRecord.h"
+
+// file layout, all values little endian:
+//   char[8]  magic "ETTTGAME"
+//   uint32   version
+//   uint32   fields, s_recordScores | s_recordVisits
+// then blocks, each of them:
+//   char[4]  marker "BLCK", where the reader picks up again after a damaged block
+//   uint32   size of the games in bytes
+//   uint32   number of games
+//   uint32   CRC-32 of the games
+// and the games, each of them:
+//   uint8    number of moves n
+//   uint8    result, a GameStatus
+//   byte[]   the moves as board * 9 + cell, 7 bits each, ceil(7 n / 8) bytes
+//   int16    scores [n], if s_recordScores
+//   varint   visits [n], LEB128, if s_recordVisits
+static constexpr char s_magic[8] = {'E', 'T', 'T', 'T', 'G', 'A', 'M', 'E'};
+static constexpr char s_blockMarker[4] = {'B', 'L', 'C', 'K'};
+static constexpr uint32_t s_version = 2;
+static constexpr std::size_t s_headerSize = 16;
+static constexpr std::size_t s_blockHeaderSize = 16;
+
+static void StoreUint32(uint8_t* p, uint32_t value) {
+  for (int i = 0; i < 4; i++)
+    p[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+static uint32_t LoadUint32(const uint8_t* p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static constexpr std::array<uint32_t, 256> s_crcTable = [] {
+  std::array<uint32_t, 256> table{};
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; bit++)
+      crc = crc & 1 ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+    table[i] = crc;
+  }
+  return table;
+}();
+
+// the CRC-32 of zlib and PNG
+static uint32_t Crc32(const uint8_t* data, std::size_t size) {
+  uint32_t crc = 0xffffffff;
+  for (std::size_t i = 0; i < size; i++)
+    crc = s_crcTable[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+  return ~crc;
+}
+
+std::unique_ptr<GameRecordFile> GameRecordFile::Create(const std::string& path, uint32_t fields) {
+  std::unique_ptr<GameRecordFile> file(new GameRecordFile());
+  file->m_fields = fields;
+  file->m_out.open(path, std::ios::binary);
+  uint8_t header[8];
+  StoreUint32(header, s_version);
+  StoreUint32(header + 4, fields);
+  file->m_out.write(s_magic, sizeof(s_magic));
+  file->m_out.write(reinterpret_cast<const char*>(header), sizeof(header));
+  if (!file->m_out) {
+    SPDLOG_ERROR("Could not create the game record file {}", path);
+    return nullptr;
+  }
+  return file;
+}
+
+void GameRecordFile::WriteBlock(const std::vector<uint8_t>& block) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_out.write(reinterpret_cast<const char*>(block.data()), static_cast<std::streamsize>(block.size()));
+  m_out.flush();
+  if (!m_out)
+    SPDLOG_ERROR("Could not write a block of game records");
+}
+
+GameRecordWriter::GameRecordWriter(GameRecordFile& file)
+    : m_file(file) {
+  m_block.reserve(s_blockSize + 1024);
+  m_block.resize(s_blockHeaderSize);
+}
+
+void GameRecordWriter::Write(const GameRecord& game) {
+  if (game.moves.size() > 9 * 9) {
+    SPDLOG_ERROR("Cannot record a game of {} moves", game.moves.size());
+    return;
+  }
+  m_block.push_back(static_cast<uint8_t>(game.moves.size()));
+  m_block.push_back(static_cast<uint8_t>(game.result));
+
+  uint32_t bits = 0;
+  int bitCount = 0;
+  for (const GameRecord::RecordedMove& recorded : game.moves) {
+    bits |= static_cast<uint32_t>(recorded.move.m_boardPosition * 9 + recorded.move.m_cellPosition) << bitCount;
+    for (bitCount += 7; bitCount >= 8; bitCount -= 8, bits >>= 8)
+      m_block.push_back(static_cast<uint8_t>(bits));
+  }
+  if (bitCount > 0)
+    m_block.push_back(static_cast<uint8_t>(bits));
+
+  if (m_file.GetFields() & s_recordScores) {
+    for (const GameRecord::RecordedMove& recorded : game.moves) {
+      uint16_t score = static_cast<uint16_t>(recorded.score);
+      m_block.push_back(static_cast<uint8_t>(score));
+      m_block.push_back(static_cast<uint8_t>(score >> 8));
+    }
+  }
+  if (m_file.GetFields() & s_recordVisits) {
+    for (const GameRecord::RecordedMove& recorded : game.moves) {
+      uint32_t visits = recorded.visits;
+      for (; visits >= 0x80; visits >>= 7)
+        m_block.push_back(static_cast<uint8_t>(visits | 0x80));
+      m_block.push_back(static_cast<uint8_t>(visits));
+    }
+  }
+
+  m_blockGames++;
+  if (m_block.size() >= s_blockSize)
+    Flush();
+}
+
+void GameRecordWriter::Flush() {
+  if (m_blockGames == 0)
+    return;
+  const uint8_t* games = m_block.data() + s_blockHeaderSize;
+  const std::size_t size = m_block.size() - s_blockHeaderSize;
+  std::memcpy(m_block.data(), s_blockMarker, sizeof(s_blockMarker));
+  StoreUint32(m_block.data() + 4, static_cast<uint32_t>(size));
+  StoreUint32(m_block.data() + 8, m_blockGames);
+  StoreUint32(m_block.data() + 12, Crc32(games, size));
+  m_file.WriteBlock(m_block);
+  m_block.resize(s_blockHeaderSize);
+  m_blockGames = 0;
+}
+
+std::unique_ptr<GameRecordReader> GameRecordReader::Open(const std::string& path) {
+  std::unique_ptr<MappedFile> file = MappedFile::Open(path);
+  if (!file)
+    return nullptr;
+
+  const uint8_t* data = file->GetData();
+  if (file->GetSize() < s_headerSize || !std::equal(s_magic, s_magic + 8, data)) {
+    SPDLOG_ERROR("{} is not a game record file", path);
+    return nullptr;
+  }
+  const uint32_t header[2] = {LoadUint32(data + 8), LoadUint32(data + 12)};
+  if (header[0] != s_version) {
+    SPDLOG_ERROR("{} has version {}, expected version {}", path, header[0], s_version);
+    return nullptr;
+  }
+
+  std::unique_ptr<GameRecordReader> reader(new GameRecordReader());
+  reader->m_path = path;
+  reader->m_fields = header[1];
+  reader->m_cursor = data + s_headerSize;
+  reader->m_blockEnd = reader->m_cursor;
+  reader->m_fileEnd = data + file->GetSize();
+  reader->m_file = std::move(file);
+  return reader;
+}
+
+bool GameRecordReader::Next(GameRecord& game) {
+  while (true) {
+    if (m_blockGamesLeft > 0) {
+      m_blockGamesLeft--;
+      if (DecodeGame(game))
+        return true;
+      SkipBlock();
+      continue;
+    }
+
+    m_cursor = m_blockEnd;
+    if (m_cursor == m_fileEnd)
+      return false;
+    if (!IsBlockIntact()) {
+      SPDLOG_ERROR("Skipping a damaged block of {} at byte {}", m_path, m_cursor - m_file->GetData());
+      m_skippedBlocks++;
+      // the size may be damaged too, so look for the marker of the next block
+      m_blockEnd = std::search(m_cursor + 1, m_fileEnd, s_blockMarker, s_blockMarker + 4);
+      continue;
+    }
+    m_blockEnd = m_cursor + s_blockHeaderSize + LoadUint32(m_cursor + 4);
+    m_blockGamesLeft = LoadUint32(m_cursor + 8);
+    m_cursor += s_blockHeaderSize;
+  }
+}
+
+bool GameRecordReader::IsBlockIntact() const {
+  const std::size_t left = m_fileEnd - m_cursor;
+  if (left < s_blockHeaderSize || !std::equal(s_blockMarker, s_blockMarker + 4, m_cursor))
+    return false;
+  const uint32_t size = LoadUint32(m_cursor + 4);
+  return size <= left - s_blockHeaderSize && Crc32(m_cursor + s_blockHeaderSize, size) == LoadUint32(m_cursor + 12);
+}
+
+bool GameRecordReader::DecodeGame(GameRecord& game) {
+  const uint8_t* p = m_cursor;
+  if (m_blockEnd - p < 2)
+    return false;
+  const int count = p[0];
+  const uint8_t result = p[1];
+  p += 2;
+  const std::size_t moveBytes = (7 * count + 7) / 8;
+  const std::size_t scoreBytes = m_fields & s_recordScores ? 2 * count : 0;
+  if (count > 9 * 9 || result > static_cast<uint8_t>(GameStatus::Draw) ||
+      static_cast<std::size_t>(m_blockEnd - p) < moveBytes + scoreBytes)
+    return false;
+
+  game.result = static_cast<GameStatus>(result);
+  game.moves.resize(count);
+  uint32_t bits = 0;
+  int bitCount = 0;
+  for (GameRecord::RecordedMove& recorded : game.moves) {
+    for (; bitCount < 7; bitCount += 8)
+      bits |= static_cast<uint32_t>(*p++) << bitCount;
+    int idx = bits & 0x7f;
+    bits >>= 7;
+    bitCount -= 7;
+    if (idx >= 9 * 9)
+      return false;
+    recorded = {ConvertIdxToMove(idx), 0, 0};
+  }
+
+  if (m_fields & s_recordScores) {
+    for (GameRecord::RecordedMove& recorded : game.moves) {
+      recorded.score = static_cast<int16_t>(p[0] | (p[1] << 8));
+      p += 2;
+    }
+  }
+  if (m_fields & s_recordVisits) {
+    for (GameRecord::RecordedMove& recorded : game.moves) {
+      uint32_t visits = 0;
+      for (int shift = 0;; shift += 7) {
+        if (p == m_blockEnd || shift > 28)
+          return false;
+        uint8_t byte = *p++;
+        visits |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+          break;
+      }
+      recorded.visits = visits;
+    }
+  }
+  m_cursor = p;
+  return true;
+}
+
+void GameRecordReader::SkipBlock() {
+  SPDLOG_ERROR("Skipping a damaged block of {} at byte {}", m_path, m_cursor - m_file->GetData());
+  m_skippedBlocks++;
+  m_blockGamesLeft = 0;
+  m_cursor = m_blockEnd;
+}
+
+GameRecordReader::Iterator::Iterator(GameRecordReader& reader)
+    : m_reader(&reader), m_game(std::make_unique<GameRecord>()) {
+  NextGame();
+}
+
+void GameRecordReader::Iterator::NextGame() {
+  while (m_reader->Next(*m_game)) {
+    if (m_game->moves.empty())
+      continue;
+    m_position.board = Board();
+    m_position.game = m_game.get();
+    m_position.ply = 0;
+    return;
+  }
+  m_done = true;
+}
+
+GameRecordReader::Iterator& GameRecordReader::Iterator::operator++() {
+  Board& board = m_position.board;
+  board.Play(m_game->moves[m_position.ply].move);
+  if (++m_position.ply == m_game->moves.size()) {
+    NextGame();
+    return *this;
+  }
+  const Move& next = m_game->moves[m_position.ply].move;
+  if (board.IsGameOver() || !board.IsMoveLegal(next)) {
+    SPDLOG_ERROR("Skipping the rest of a game of {}, move {} is illegal after {}", m_reader->m_path, next,
+                 board.ToNotation());
+    NextGame();
+  }
+  return *this;
+}
@@ -0,0 +1,161 @@
+#pragma once
+#include "Board.h"
+#include "MappedFile.h"
+
+/**
+ * A finished game as stored in a game record file. Games always start
+ * from the empty board, openings are part of the moves.
+ */
+struct GameRecord {
+  struct RecordedMove {
+    Move move;
+    // score of the move for the player who made it, 0 if not recorded
+    int16_t score = 0;
+    // positions searched to find the move, 0 if not recorded
+    uint32_t visits = 0;
+  };
+
+  GameStatus result = GameStatus::InProgress;
+  std::vector<RecordedMove> moves;
+};
+
+// what a game record file stores besides the moves and the result
+constexpr uint32_t s_recordScores = 1;
+constexpr uint32_t s_recordVisits = 2;
+
+/**
+ * File that game records are appended to by any number of
+ * GameRecordWriters, usually one per thread.
+ *
+ * The games are grouped in blocks that can be decoded on their own, so
+ * a damaged block only loses its own games. Each block starts with a
+ * marker and a checksum of its games, so a reader can find the next block
+ * even when the size of a damaged one is wrong. Inside a block each game is
+ * its length, its result and its moves packed in 7 bits each, followed by
+ * the optional scores and visit counts.
+ */
+class GameRecordFile {
+public:
+  /**
+   * @param fields s_recordScores and s_recordVisits, or 0 for the moves only
+   * @return the file, or nullptr if it cannot be created
+   */
+  static std::unique_ptr<GameRecordFile> Create(const std::string& path, uint32_t fields);
+
+  uint32_t GetFields() const { return m_fields; }
+
+private:
+  friend class GameRecordWriter;
+  GameRecordFile() = default;
+
+  // appends a whole block, the only time the writers synchronize
+  void WriteBlock(const std::vector<uint8_t>& block);
+
+  std::ofstream m_out;
+  std::mutex m_mutex;
+  uint32_t m_fields = 0;
+};
+
+/**
+ * Buffers the games of one thread into a block and hands it to the file
+ * once full, so threads only meet once per block.
+ */
+class GameRecordWriter {
+public:
+  explicit GameRecordWriter(GameRecordFile& file);
+  ~GameRecordWriter() { Flush(); }
+
+  GameRecordWriter(const GameRecordWriter&) = delete;
+  GameRecordWriter& operator=(const GameRecordWriter&) = delete;
+
+  void Write(const GameRecord& game);
+  // writes the games buffered so far as a block
+  void Flush();
+
+private:
+  static constexpr std::size_t s_blockSize = 1 << 16;
+
+  GameRecordFile& m_file;
+  // block header followed by the games
+  std::vector<uint8_t> m_block;
+  uint32_t m_blockGames = 0;
+};
+
+/**
+ * Reads a game record file mapped into memory, either game by game with
+ * Next or position by position, replaying the moves with Board::Play:
+ *
+ *   for (const GameRecordReader::Position& position : *reader)
+ *     Train(position.board, position.game->moves[position.ply]);
+ *
+ * Damaged blocks and games with illegal moves are logged and skipped.
+ */
+class GameRecordReader {
+public:
+  /**
+   * @return the reader, or nullptr if the file is missing or not a game record file
+   */
+  static std::unique_ptr<GameRecordReader> Open(const std::string& path);
+
+  /**
+   * Decodes the next game
+   *
+   * @return false once every game has been read
+   */
+  bool Next(GameRecord& game);
+  uint32_t GetFields() const { return m_fields; }
+  std::size_t GetSkippedBlocks() const { return m_skippedBlocks; }
+
+  struct Position {
+    // the position before the move
+    Board board;
+    const GameRecord* game = nullptr;
+    // index of the move in game->moves
+    std::size_t ply = 0;
+  };
+
+  class Iterator {
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = Position;
+    using difference_type = std::ptrdiff_t;
+
+    explicit Iterator(GameRecordReader& reader);
+    const Position& operator*() const { return m_position; }
+    const Position* operator->() const { return &m_position; }
+    Iterator& operator++();
+    bool operator==(std::default_sentinel_t) const { return m_done; }
+
+  private:
+    // moves on to the first position of the next game with moves
+    void NextGame();
+
+    GameRecordReader* m_reader;
+    // on the heap, so m_position.game stays valid when the iterator is moved
+    std::unique_ptr<GameRecord> m_game;
+    Position m_position;
+    bool m_done = false;
+  };
+  // single pass, the positions come from the games Next has not read yet
+  Iterator begin() { return Iterator(*this); }
+  std::default_sentinel_t end() { return {}; }
+
+private:
+  GameRecordReader() = default;
+
+  // whether a whole block with a matching checksum starts at m_cursor
+  bool IsBlockIntact() const;
+  // decodes the game at m_cursor, false if the block is damaged
+  bool DecodeGame(GameRecord& game);
+  void SkipBlock();
+
+  std::unique_ptr<MappedFile> m_file;
+  std::string m_path;
+  uint32_t m_fields = 0;
+  // current position in the file, and the end of the block it is in
+  const uint8_t* m_cursor = nullptr;
+  const uint8_t* m_blockEnd = nullptr;
+  const uint8_t* m_fileEnd = nullptr;
+  uint32_t m_blockGamesLeft = 0;
+  std::size_t m_skippedBlocks = 0;
+};
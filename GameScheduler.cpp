@@ -0,0 +1,114 @@
+#include "pch.h"
+#include "GameScheduler.h"
+
+struct GameScheduler::SpawnedTask {
+  struct promise_type {
+    SpawnedTask get_return_object() { return {std::coroutine_handle<promise_type>::from_promise(*this)}; }
+    // started by Post, on one of the threads
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    std::suspend_never final_suspend() const noexcept { return {}; }
+    void return_void() const noexcept {}
+    // RunSpawned catches everything
+    void unhandled_exception() const noexcept { std::terminate(); }
+  };
+
+  std::coroutine_handle<promise_type> handle;
+};
+
+GameScheduler::SpawnedTask GameScheduler::RunSpawned(GameScheduler& scheduler, Task<void> task) {
+  try {
+    co_await std::move(task);
+  } catch (const std::exception& e) {
+    SPDLOG_ERROR("A scheduled task failed: {}", e.what());
+  }
+  scheduler.OnTaskDone();
+}
+
+GameScheduler::GameScheduler(int threads) {
+  for (int i = 0; i < std::max(1, threads); i++)
+    m_threads.emplace_back([this] { Work(); });
+}
+
+GameScheduler::~GameScheduler() {
+  WaitIdle();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_isStopping = true;
+  }
+  m_workReady.notify_all();
+  for (std::thread& thread : m_threads)
+    thread.join();
+}
+
+void GameScheduler::Spawn(Task<void> task) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_activeTasks++;
+  }
+  Post(RunSpawned(*this, std::move(task)).handle);
+}
+
+void GameScheduler::WaitIdle() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_idle.wait(lock, [this] { return m_activeTasks == 0; });
+}
+
+void GameScheduler::Post(std::coroutine_handle<> handle) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_ready.push_back(handle);
+  }
+  m_workReady.notify_one();
+}
+
+uint64_t GameScheduler::PostAt(std::chrono::steady_clock::time_point wakeUp, std::coroutine_handle<> handle) {
+  uint64_t id;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    id = m_nextTimerId++;
+    m_timers.push({wakeUp, handle, id});
+    m_pendingTimers.insert(id);
+  }
+  // a thread waiting for a later timer has to wait less now
+  m_workReady.notify_one();
+  return id;
+}
+
+bool GameScheduler::CancelTimer(uint64_t id) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_pendingTimers.erase(id) > 0;
+}
+
+void GameScheduler::OnTaskDone() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (--m_activeTasks == 0)
+    m_idle.notify_all();
+}
+
+void GameScheduler::Work() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    const auto now = std::chrono::steady_clock::now();
+    while (!m_timers.empty() && m_timers.top().wakeUp <= now) {
+      if (m_pendingTimers.erase(m_timers.top().id) > 0)
+        m_ready.push_back(m_timers.top().handle);
+      m_timers.pop();
+    }
+
+    if (!m_ready.empty()) {
+      std::coroutine_handle<> handle = m_ready.front();
+      m_ready.pop_front();
+      // runs until the coroutine suspends again or finishes
+      lock.unlock();
+      handle.resume();
+      lock.lock();
+      continue;
+    }
+    if (m_isStopping)
+      return;
+    if (m_timers.empty())
+      m_workReady.wait(lock);
+    else
+      m_workReady.wait_until(lock, m_timers.top().wakeUp);
+  }
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include "Task.h"
+
+/**
+ * Runs coroutines, typically whole games, on a fixed number of threads.
+ * A coroutine waiting for something, a click or a timer, is suspended
+ * and gives its thread to the others, so thousands of games only need
+ * as many threads as there are cores.
+ */
+class GameScheduler {
+public:
+  explicit GameScheduler(int threads);
+  // waits for the spawned tasks
+  ~GameScheduler();
+
+  GameScheduler(const GameScheduler&) = delete;
+  GameScheduler& operator=(const GameScheduler&) = delete;
+
+  // runs task on the threads, it is destroyed once done
+  void Spawn(Task<void> task);
+  // blocks the caller until every spawned task is done
+  void WaitIdle();
+  // resumes a suspended coroutine on one of the threads, from any thread
+  void Post(std::coroutine_handle<> handle);
+  /**
+   * Resumes a suspended coroutine on one of the threads once wakeUp has
+   * passed, unless the timer is cancelled before
+   *
+   * @return the id of the timer, for CancelTimer
+   */
+  uint64_t PostAt(std::chrono::steady_clock::time_point wakeUp, std::coroutine_handle<> handle);
+  /**
+   * @return true if the timer was cancelled before it fired, false if its
+   * coroutine is resumed, or about to be
+   */
+  bool CancelTimer(uint64_t id);
+
+  struct SleepAwaiter {
+    GameScheduler& scheduler;
+    std::chrono::steady_clock::time_point wakeUp;
+
+    bool await_ready() const { return wakeUp <= std::chrono::steady_clock::now(); }
+    void await_suspend(std::coroutine_handle<> handle) { scheduler.PostAt(wakeUp, handle); }
+    void await_resume() const {}
+  };
+  // co_await scheduler.Sleep(duration) suspends without holding a thread
+  SleepAwaiter Sleep(std::chrono::nanoseconds duration) {
+    return {*this, std::chrono::steady_clock::now() + duration};
+  }
+
+  int GetThreadCount() const { return static_cast<int>(m_threads.size()); }
+
+private:
+  struct Timer {
+    std::chrono::steady_clock::time_point wakeUp;
+    std::coroutine_handle<> handle;
+    uint64_t id;
+    bool operator>(const Timer& other) const { return wakeUp > other.wakeUp; }
+  };
+
+  // coroutine running a spawned task, which destroys itself once done
+  struct SpawnedTask;
+  static SpawnedTask RunSpawned(GameScheduler& scheduler, Task<void> task);
+
+  void Work();
+  void OnTaskDone();
+
+  std::mutex m_mutex;
+  std::condition_variable m_workReady;
+  std::condition_variable m_idle;
+  std::deque<std::coroutine_handle<>> m_ready;
+  // earliest first
+  std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> m_timers;
+  // timers neither fired nor cancelled, the cancelled ones are only skipped
+  // when they come out of m_timers
+  std::unordered_set<uint64_t> m_pendingTimers;
+  uint64_t m_nextTimerId = 0;
+  std::size_t m_activeTasks = 0;
+  bool m_isStopping = false;
+  std::vector<std::thread> m_threads;
+};
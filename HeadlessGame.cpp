@@ -0,0 +1,63 @@
+#include "pch.h"
+#include "HeadlessGame.h"
+
+GameStatus HeadlessGame::Play(const Board& initial) {
+  StartGame(initial);
+  while (!m_board.IsGameOver()) {
+    Move move = StartTurn().GetMove();
+    if (std::optional<GameStatus> forfeit = EndTurn(move))
+      return *forfeit;
+  }
+  return m_board.GetTopGameStatus();
+}
+
+Task<GameStatus> HeadlessGame::PlayAsync(GameScheduler& scheduler, Board initial) {
+  StartGame(initial);
+  while (!m_board.IsGameOver()) {
+    Move move = co_await StartTurn().GetMoveAsync(scheduler);
+    if (std::optional<GameStatus> forfeit = EndTurn(move))
+      co_return *forfeit;
+  }
+  co_return m_board.GetTopGameStatus();
+}
+
+void HeadlessGame::StartGame(const Board& initial) {
+  m_board = initial;
+  m_playerX.Reset();
+  m_playerO.Reset();
+  m_playerX.Initialize(PlayerSymbol::X, m_board);
+  m_playerO.Initialize(PlayerSymbol::O, m_board);
+  m_flagged = std::nullopt;
+  m_clock.reset();
+  if (m_timeControl)
+    m_clock.emplace(*m_timeControl);
+}
+
+Player& HeadlessGame::StartTurn() {
+  PlayerSymbol ps = m_board.GetCurrentPlayer();
+  Player& currentPlayer = ps == PlayerSymbol::X ? m_playerX : m_playerO;
+  if (m_clock) {
+    currentPlayer.SetTimeLeft(m_clock->GetRemaining(ps), m_timeControl->increment);
+    m_clock->Start(ps);
+  }
+  return currentPlayer;
+}
+
+std::optional<GameStatus> HeadlessGame::EndTurn(const Move& move) {
+  PlayerSymbol ps = m_board.GetCurrentPlayer();
+  Player& otherPlayer = ps == PlayerSymbol::X ? m_playerO : m_playerX;
+
+  if (m_clock && !m_clock->Stop()) {
+    SPDLOG_WARN("{} ran out of time, forfeiting the game", ps);
+    m_flagged = ps;
+    return ps == PlayerSymbol::X ? GameStatus::OWins : GameStatus::XWins;
+  }
+  if (!m_board.IsMoveLegal(move)) {
+    SPDLOG_ERROR("{} played the illegal move {}, forfeiting the game", ps, move);
+    return ps == PlayerSymbol::X ? GameStatus::OWins : GameStatus::XWins;
+  }
+
+  otherPlayer.ReceiveMove(move);
+  m_board.Play(move);
+  return std::nullopt;
+}
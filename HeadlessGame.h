@@ -0,0 +1,67 @@
+#pragma once
+#include "GameClock.h"
+#include "players/Player.h"
+
+/**
+ * Runs a game between two players on the calling thread, without
+ * creating a window or initializing GLFW. Used by the command line
+ * tools that play many engine games in a row.
+ */
+class HeadlessGame {
+public:
+  HeadlessGame(Player& playerX, Player& playerO)
+      : m_playerX(playerX), m_playerO(playerO) {}
+
+  /**
+   * Resets and initializes both players, then plays
+   * the game to the end starting from the given position
+   *
+   * @param initial the position the game starts from
+   * @return the final status of the game. A player that returns an
+   * illegal move loses the game, since asking a deterministic player
+   * again would never end. So does a player running out of time
+   */
+  GameStatus Play(const Board& initial);
+
+  /**
+   * Same as Play, but asks the players with GetMoveAsync so the game
+   * only holds a scheduler thread while a player is computing a move.
+   * The game and its players must outlive the returned task
+   *
+   * @param scheduler the scheduler the task runs on
+   * @param initial the position the game starts from
+   * @return the final status of the game
+   */
+  Task<GameStatus> PlayAsync(GameScheduler& scheduler, Board initial);
+
+  const Board& GetBoard() const { return m_board; }
+
+  // the next games are played with a clock, or without one if nullopt
+  void SetTimeControl(const std::optional<TimeControl>& control) { m_timeControl = control; }
+  // the player who lost the last game on time, if any
+  std::optional<PlayerSymbol> GetFlagged() const { return m_flagged; }
+
+private:
+  // Play and PlayAsync only differ in how they ask for a move, the turns are
+  // started and ended the same way
+
+  // resets the board, the players and the clock
+  void StartGame(const Board& initial);
+  // @return the player to move, whose clock is started
+  Player& StartTurn();
+  /**
+   * Stops the clock of the player to move and plays its move
+   *
+   * @return the final status of the game if the player forfeits it, by
+   * running out of time or playing an illegal move
+   */
+  std::optional<GameStatus> EndTurn(const Move& move);
+
+  Player& m_playerX;
+  Player& m_playerO;
+  Board m_board;
+  std::optional<TimeControl> m_timeControl;
+  // the clock of the game being played, if it has a time control
+  std::optional<GameClock> m_clock;
+  std::optional<PlayerSymbol> m_flagged;
+};
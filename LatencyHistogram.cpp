@@ -0,0 +1,68 @@
+#include "pch.h"
+#include "LatencyHistogram.h"
+
+int LatencyHistogram::GetBucket(uint64_t ns) {
+  if (ns < s_subBuckets)
+    return static_cast<int>(ns);
+  // the leading bit and the s_subBucketBits after it pick the bucket
+  int shift = std::bit_width(ns) - 1 - s_subBucketBits;
+  return (shift + 1) * s_subBuckets + static_cast<int>((ns >> shift) & (s_subBuckets - 1));
+}
+
+uint64_t LatencyHistogram::GetBucketMax(int bucket) {
+  if (bucket < s_subBuckets)
+    return static_cast<uint64_t>(bucket);
+  int shift = bucket / s_subBuckets - 1;
+  uint64_t first = static_cast<uint64_t>(s_subBuckets + bucket % s_subBuckets) << shift;
+  return first + ((uint64_t(1) << shift) - 1);
+}
+
+void LatencyHistogram::Record(std::chrono::nanoseconds duration) {
+  uint64_t ns = static_cast<uint64_t>(std::max<int64_t>(duration.count(), 0));
+  m_counts[GetBucket(ns)]++;
+  m_count++;
+  m_max = std::max(m_max, ns);
+  m_total += ns;
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+  for (int bucket = 0; bucket < s_bucketCount; bucket++)
+    m_counts[bucket] += other.m_counts[bucket];
+  m_count += other.m_count;
+  m_max = std::max(m_max, other.m_max);
+  m_total += other.m_total;
+}
+
+std::chrono::nanoseconds LatencyHistogram::GetMean() const {
+  return std::chrono::nanoseconds(m_count ? m_total / m_count : 0);
+}
+
+std::chrono::nanoseconds LatencyHistogram::GetPercentile(double fraction) const {
+  if (m_count == 0)
+    return std::chrono::nanoseconds(0);
+  // rank of the sample, counting from 1
+  uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(m_count))));
+  uint64_t seen = 0;
+  for (int bucket = 0; bucket < s_bucketCount; bucket++) {
+    seen += m_counts[bucket];
+    if (seen >= rank)
+      return std::chrono::nanoseconds(std::min(GetBucketMax(bucket), m_max));
+  }
+  return GetMax();
+}
+
+std::ostream& operator<<(std::ostream& out, const LatencyHistogram& histogram) {
+  auto ms = [](std::chrono::nanoseconds duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  };
+  // format in a separate stream so the caller's flags are left untouched
+  std::ostringstream os;
+  os << std::fixed << std::setprecision(3)
+     << "count=" << histogram.GetCount()
+     << " mean_ms=" << ms(histogram.GetMean())
+     << " p50_ms=" << ms(histogram.GetPercentile(0.5))
+     << " p90_ms=" << ms(histogram.GetPercentile(0.9))
+     << " p99_ms=" << ms(histogram.GetPercentile(0.99))
+     << " max_ms=" << ms(histogram.GetMax());
+  return out << os.str();
+}
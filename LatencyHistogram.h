@@ -0,0 +1,49 @@
+#pragma once
+
+/**
+ * Histogram of durations to report percentiles of any number of samples
+ * in constant memory. Durations are grouped in buckets 1/16th as wide as
+ * their magnitude, so a percentile is off by less than 6.25%.
+ *
+ * Not thread safe, give every thread its own and merge them.
+ */
+class LatencyHistogram {
+public:
+  void Record(std::chrono::nanoseconds duration);
+  void Merge(const LatencyHistogram& other);
+  void Clear() { *this = LatencyHistogram(); }
+
+  uint64_t GetCount() const { return m_count; }
+  std::chrono::nanoseconds GetMean() const;
+  std::chrono::nanoseconds GetMax() const { return std::chrono::nanoseconds(m_max); }
+  /**
+   * @param fraction of the samples, between 0 and 1, e.g. 0.99
+   * @return the duration that fraction of the samples do not exceed
+   */
+  std::chrono::nanoseconds GetPercentile(double fraction) const;
+
+private:
+  static constexpr int s_subBucketBits = 4;
+  static constexpr int s_subBuckets = 1 << s_subBucketBits;
+  // durations below s_subBuckets ns have one bucket each, then
+  // s_subBuckets per power of two up to 2^64 ns
+  static constexpr int s_bucketCount = (64 - s_subBucketBits + 1) * s_subBuckets;
+
+  static int GetBucket(uint64_t ns);
+  // largest duration that falls in the bucket
+  static uint64_t GetBucketMax(int bucket);
+
+  std::array<uint64_t, s_bucketCount> m_counts = {0};
+  uint64_t m_count = 0;
+  uint64_t m_max = 0;
+  // sum of the samples in ns, 2^64 ns is more than 500 years
+  uint64_t m_total = 0;
+};
+
+/**
+ * Writes count, mean, p50, p90, p99 and max in milliseconds,
+ * as space separated key=value pairs
+ */
+std::ostream& operator<<(std::ostream& os, const LatencyHistogram& histogram);
+template <>
+struct fmt::formatter<LatencyHistogram> : fmt::ostream_formatter {};
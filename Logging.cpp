@@ -0,0 +1,66 @@
+#include "pch.h"
+#include "Logging.h"
+
+#include "spdlog/async.h"
+#include "spdlog/sinks/basic_file_sink.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+
+namespace Logging {
+
+static std::shared_ptr<spdlog::logger> s_events;
+
+static std::shared_ptr<spdlog::logger> MakeLogger(const std::string& name, std::vector<spdlog::sink_ptr> sinks,
+                                                  const Config& config) {
+  if (!config.isAsync)
+    return std::make_shared<spdlog::logger>(name, sinks.begin(), sinks.end());
+  auto policy = config.dropWhenFull ? spdlog::async_overflow_policy::overrun_oldest
+                                    : spdlog::async_overflow_policy::block;
+  return std::make_shared<spdlog::async_logger>(name, sinks.begin(), sinks.end(), spdlog::thread_pool(), policy);
+}
+
+bool Init(const Config& config) {
+  if (config.isAsync)
+    spdlog::init_thread_pool(std::max<std::size_t>(config.queueSize, 1), 1);
+
+  std::vector<spdlog::sink_ptr> sinks;
+  std::shared_ptr<spdlog::sinks::basic_file_sink_mt> eventsSink;
+  try {
+    if (config.console)
+      sinks.push_back(std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
+    if (!config.path.empty())
+      sinks.push_back(std::make_shared<spdlog::sinks::basic_file_sink_mt>(config.path, true));
+    if (!config.eventsPath.empty())
+      eventsSink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(config.eventsPath, true);
+  } catch (const spdlog::spdlog_ex& e) {
+    SPDLOG_ERROR("Could not open the log: {}", e.what());
+    return false;
+  }
+
+  std::shared_ptr<spdlog::logger> logger = MakeLogger("extreme_ttt", std::move(sinks), config);
+  logger->set_level(config.level);
+  spdlog::set_default_logger(logger);
+
+  if (eventsSink) {
+    eventsSink->set_pattern(R"({"time":"%Y-%m-%dT%H:%M:%S.%f",%v})");
+    s_events = MakeLogger("events", {eventsSink}, config);
+    s_events->set_level(spdlog::level::info);
+    // the events are read by other programs, a crash should not lose them
+    s_events->flush_on(spdlog::level::info);
+  }
+  return true;
+}
+
+void Shutdown() {
+  s_events = nullptr;
+  // drains the queue and joins the background thread
+  spdlog::shutdown();
+  // anything logged later, e.g. by a static destructor, goes straight to the console
+  spdlog::set_default_logger(std::make_shared<spdlog::logger>(
+      "extreme_ttt", std::make_shared<spdlog::sinks::stdout_color_sink_mt>()));
+}
+
+spdlog::logger* GetEvents() {
+  return s_events.get();
+}
+
+} // namespace Logging
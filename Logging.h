@@ -0,0 +1,51 @@
+#pragma once
+
+/**
+ * Process wide logging. The game and search threads only format their
+ * messages and push them on a bounded queue, a background thread writes
+ * them to the console and the log file.
+ *
+ * Besides the text log, the moves and searches can be written as
+ * structured events, one JSON object per line:
+ *
+ *   {"time":"2024-11-02T10:31:07.412903","event":"search","player":"X","move":"40",...}
+ *
+ * Logging only computations must be guarded, with GetEvents or with
+ * spdlog::should_log, so they cost nothing when the level is off.
+ */
+namespace Logging {
+
+struct Config {
+  spdlog::level::level_enum level = spdlog::level::info;
+  bool console = true;
+  // text log written in addition to the console, none if empty
+  std::string path;
+  // JSON lines file of the structured events, none if empty
+  std::string eventsPath;
+  // messages waiting for the background thread
+  std::size_t queueSize = 8192;
+  // a full queue drops its oldest messages instead of blocking the thread logging
+  bool dropWhenFull = true;
+  // writes on the thread logging instead, to compare
+  bool isAsync = true;
+};
+
+/**
+ * Replaces the default logger, call it before starting other threads
+ *
+ * @return false if a log file could not be opened
+ */
+bool Init(const Config& config);
+
+// writes what is queued and stops the background thread, at the end of main
+void Shutdown();
+
+/**
+ * Logger of the structured events, its messages are the fields of the
+ * JSON object without the braces, e.g. "event":"move","move":"40"
+ *
+ * @return the logger, or nullptr if there is no events file
+ */
+spdlog::logger* GetEvents();
+
+} // namespace Logging
@@ -2,12 +2,77 @@
 
 #include "Board.h"
 #include "Game.h"
+#include "Logging.h"
+#include "Trace.h"
 #include "players/HumanPlayer.h"
 #include "players/AIPlayer.h"
 #include "players/RandomPlayer.h"
 
-int main(void) {
-  spdlog::set_level(spdlog::level::trace);
+static void PrintUsage() {
+  fmt::print(
+      "usage: extreme_ttt [options]\n"
+      "  --engine <config>      engine configuration, e.g. multipv=3 to log its best moves\n"
+      "  --tc <base+inc>        clock of each side in seconds, e.g. 10+0.1 (default: none)\n"
+      "  --log-level <level>    trace, debug, info, warning, error, critical or off (default info)\n"
+      "  --log <file>           also writes the log to a file\n"
+      "  --events <file>        writes every move and search as one JSON object per line\n"
+      "  --trace <file>         records chrome trace events for the whole session\n");
+}
+
+struct Options {
+  AIConfig engine;
+  std::optional<TimeControl> timeControl;
+  Logging::Config logging;
+  std::string tracePath;
+};
+
+/**
+ * @throws std::invalid_argument on unknown options or invalid values
+ */
+static Options ParseOptions(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc)
+      throw std::invalid_argument("Missing value for " + arg);
+    std::string value = argv[++i];
+
+    if (arg == "--engine") {
+      options.engine = AIConfig::Parse(value);
+    } else if (arg == "--tc") {
+      options.timeControl = TimeControl::Parse(value);
+    } else if (arg == "--log-level") {
+      // from_str turns anything it does not know into off
+      options.logging.level = spdlog::level::from_str(value);
+      if (options.logging.level == spdlog::level::off && value != "off")
+        throw std::invalid_argument("Unknown log level " + value);
+    } else if (arg == "--log") {
+      options.logging.path = value;
+    } else if (arg == "--events") {
+      options.logging.eventsPath = value;
+    } else if (arg == "--trace") {
+      options.tracePath = value;
+    } else {
+      throw std::invalid_argument("Unknown option " + arg);
+    }
+  }
+  return options;
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  try {
+    options = ParseOptions(argc, argv);
+  } catch (const std::exception& e) {
+    fmt::print(stderr, "{}\n", e.what());
+    PrintUsage();
+    return 1;
+  }
+  if (!options.tracePath.empty())
+    Trace::Start(options.tracePath);
+  if (!Logging::Init(options.logging))
+    return 1;
+  TRACE_THREAD_NAME("main");
   SPDLOG_INFO(R"(
      _____      _                             _____ _        _____            _____          
     | ____|_  _| |_ _ __ ___ _ __ ___   ___  |_   _(_) ___  |_   _|_ _  ___  |_   _|__   ___ 
@@ -42,16 +107,22 @@ o	x	.	o	o	x	o	.	o
   // )";
   //   Board initialBoard(initiailBoardStr, Move(7, 2));
 
-  // Game game(initialBoard);
-  Game game;
-  game.RegisterPlayer(std::make_unique<HumanPlayer>());
-  game.RegisterPlayer(std::make_unique<AIPlayer>());
+  {
+    // Game game(initialBoard);
+    Game game;
+    game.RegisterPlayer(std::make_unique<HumanPlayer>());
+    game.RegisterPlayer(std::make_unique<AIPlayer>(options.engine));
+    if (options.timeControl)
+      game.SetTimeControl(*options.timeControl);
 
-  game.RunGUI();
+    game.RunGUI();
+  }
 
-  SPDLOG_INFO("Cache hit ratio: {}", AIPlayer::HitRatio());
-  std::pair<int, int> stats = AIPlayer::HitStats();
-  SPDLOG_INFO("\t\tAttempted: {}, Found: {}", stats.first, stats.second);
+  SPDLOG_INFO("Search totals: {}", AIPlayer::GetTotalSearchStats());
+  // the players hand over their scores when they are destroyed
+  AIPlayer::SaveScoreCaches();
+  Trace::Stop();
+  Logging::Shutdown();
 
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "pch.h"
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+std::unique_ptr<MappedFile> MappedFile::Open(const std::string& path) {
+  std::unique_ptr<MappedFile> file(new MappedFile());
+  file->m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file->m_file == INVALID_HANDLE_VALUE) {
+    file->m_file = nullptr;
+    SPDLOG_ERROR("Could not open {}", path);
+    return nullptr;
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file->m_file, &size) || size.QuadPart == 0) {
+    SPDLOG_ERROR("Could not map {}, it is empty or unreadable", path);
+    return nullptr;
+  }
+  file->m_size = static_cast<std::size_t>(size.QuadPart);
+
+  file->m_mapping = CreateFileMappingA(file->m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!file->m_mapping) {
+    SPDLOG_ERROR("Could not map {}", path);
+    return nullptr;
+  }
+  file->m_data = static_cast<const uint8_t*>(MapViewOfFile(file->m_mapping, FILE_MAP_READ, 0, 0, 0));
+  if (!file->m_data) {
+    SPDLOG_ERROR("Could not map {}", path);
+    return nullptr;
+  }
+  return file;
+}
+
+MappedFile::~MappedFile() {
+  if (m_data)
+    UnmapViewOfFile(m_data);
+  if (m_mapping)
+    CloseHandle(m_mapping);
+  if (m_file)
+    CloseHandle(m_file);
+}
+
+#else
+
+std::unique_ptr<MappedFile> MappedFile::Open(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    SPDLOG_ERROR("Could not open {}", path);
+    return nullptr;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size == 0) {
+    SPDLOG_ERROR("Could not map {}, it is empty or unreadable", path);
+    close(fd);
+    return nullptr;
+  }
+
+  std::size_t size = static_cast<std::size_t>(info.st_size);
+  void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  // the mapping keeps its own reference to the file
+  close(fd);
+  if (data == MAP_FAILED) {
+    SPDLOG_ERROR("Could not map {}", path);
+    return nullptr;
+  }
+
+  std::unique_ptr<MappedFile> file(new MappedFile());
+  file->m_data = static_cast<const uint8_t*>(data);
+  file->m_size = size;
+  return file;
+}
+
+MappedFile::~MappedFile() {
+  if (m_data)
+    munmap(const_cast<uint8_t*>(m_data), m_size);
+}
+
+#endif
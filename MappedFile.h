@@ -0,0 +1,33 @@
+#pragma once
+
+/**
+ * Read only view of a whole file mapped into memory. Opening is
+ * instant whatever the size, pages are only read from disk when
+ * they are touched and are shared with other processes.
+ */
+class MappedFile {
+public:
+  /**
+   * @param path the file to map
+   * @return the mapping, or nullptr if the file is missing or empty
+   */
+  static std::unique_ptr<MappedFile> Open(const std::string& path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const uint8_t* GetData() const { return m_data; }
+  std::size_t GetSize() const { return m_size; }
+
+private:
+  MappedFile() = default;
+
+  const uint8_t* m_data = nullptr;
+  std::size_t m_size = 0;
+#ifdef _WIN32
+  // HANDLEs of the file and of its mapping
+  void* m_file = nullptr;
+  void* m_mapping = nullptr;
+#endif
+};
@@ -1,3 +1,18 @@
+#include "FrameProfiler.h"
+
+// draw calls and vertices sent by the functions below, the render loop
+// resets them every frame
+struct DrawCounters {
+  uint32_t drawCalls = 0;
+  uint32_t vertices = 0;
+};
+static DrawCounters s_drawCounters;
+
+static void CountDraw(uint32_t vertices) {
+  s_drawCounters.drawCalls++;
+  s_drawCounters.vertices += vertices;
+}
+
 /**
  * Renders the small boards in a 3x3 configuration.
  * Sets up an orthographic projection matching the board dimensions
@@ -15,6 +30,7 @@ void RenderSmallBoards() {
   glColor3f(0.2f, 0.2f, 0.2f);
   glLineWidth(1.f);
   glBegin(GL_LINES);
+  uint32_t vertices = 0;
 
   // horizontal lines
   for (int i = 1; i < width; ++i) {
@@ -23,6 +39,7 @@ void RenderSmallBoards() {
 
     glVertex2d(i, 0);
     glVertex2d(i, height);
+    vertices += 2;
   }
 
   // vertical lines
@@ -32,9 +49,11 @@ void RenderSmallBoards() {
 
     glVertex2d(0, j);
     glVertex2d(width, j);
+    vertices += 2;
   }
 
   glEnd();
+  CountDraw(vertices);
 }
 
 /**
@@ -67,6 +86,7 @@ void RenderBigBoard() {
   }
 
   glEnd();
+  CountDraw(2 * (width - 1) + 2 * (height - 1));
 }
 
 /**
@@ -88,6 +108,7 @@ void RenderX(int row, int col, const GLfloat* color, float thickness = 3.f) {
   glVertex2f(col + 0.2f, row + 0.8f);
   glVertex2f(col + 0.8f, row + 0.2f);
   glEnd();
+  CountDraw(4);
 }
 
 /**
@@ -108,6 +129,7 @@ void RenderO(int row, int col, const GLfloat* color, float thickness = 3.f) {
     glVertex2f(col + 0.5f + 0.4f * cos(angle), row + 0.5f + 0.4f * sin(angle));
   }
   glEnd();
+  CountDraw(101);
 }
 
 /**
@@ -131,4 +153,60 @@ void RenderBoardBorder(int boardPosition) {
   glVertex2d(startingCol + boardSize, startingRow - boardSize);
   glVertex2d(startingCol, startingRow - boardSize);
   glEnd();
+  CountDraw(4);
+}
+
+/**
+ * Renders the CPU (green) and GPU (magenta) time of the last frames as
+ * bars along the bottom of the window, oldest first. The line marks the
+ * 1/60th of a second a frame has at 60 fps, the bars are scaled to fit
+ * the slowest frame but never shrink below it.
+ *
+ * @param profiler the profiler of the render loop
+ */
+void RenderFrameGraph(const FrameProfiler& profiler) {
+  const int frames = FrameProfiler::s_historySize;
+  const float budget = 1000.f / 60.f;
+
+  float scale = budget;
+  for (int i = 0; i < frames; ++i)
+    scale = std::max({scale, profiler.GetCpuHistory(i), profiler.GetGpuHistory(i)});
+
+  // the graph takes the bottom fifth of the window
+  glLoadIdentity();
+  glOrtho(0, frames, 0, scale * 5, -1, 1);
+
+  glColor3f(0.f, 0.8f, 0.f);
+  glBegin(GL_QUADS);
+  for (int i = 0; i < frames; ++i) {
+    const float cpu = profiler.GetCpuHistory(i);
+    glVertex2f(i, 0);
+    glVertex2f(i + 1.f, 0);
+    glVertex2f(i + 1.f, cpu);
+    glVertex2f(i, cpu);
+  }
+  glEnd();
+  CountDraw(4 * frames);
+
+  if (profiler.HasGpuTimer()) {
+    glColor3f(0.9f, 0.f, 0.9f);
+    glBegin(GL_QUADS);
+    for (int i = 0; i < frames; ++i) {
+      const float gpu = profiler.GetGpuHistory(i);
+      glVertex2f(i + 0.25f, 0);
+      glVertex2f(i + 0.75f, 0);
+      glVertex2f(i + 0.75f, gpu);
+      glVertex2f(i + 0.25f, gpu);
+    }
+    glEnd();
+    CountDraw(4 * frames);
+  }
+
+  glColor3f(1.f, 1.f, 0.f);
+  glLineWidth(1.f);
+  glBegin(GL_LINES);
+  glVertex2f(0, budget);
+  glVertex2f(frames, budget);
+  glEnd();
+  CountDraw(2);
 }
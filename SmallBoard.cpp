@@ -0,0 +1,114 @@
+#include "pch.h"
+#include "SmallBoard.h"
+
+// the winning lines of a 3x3 grid as bit masks of its cells
+static constexpr std::array<uint16_t, 8> s_lineMasks = {
+    // rows
+    0b000000111,
+    0b000111000,
+    0b111000000,
+    // columns
+    0b001001001,
+    0b010010010,
+    0b100100100,
+    // diags
+    0b100010001,
+    0b001010100,
+};
+
+constexpr std::array<uint16_t, 512> calcBase3() {
+  std::array<uint16_t, 512> base3 = {0};
+  for (int mask = 0; mask < 512; mask++) {
+    int value = 0;
+    for (int cell = 8; cell >= 0; cell--)
+      value = value * 3 + ((mask >> cell) & 1);
+    base3[mask] = static_cast<uint16_t>(value);
+  }
+  return base3;
+}
+
+// per cell mask: bit l is set when the mask has that many cells of line l
+struct LineCounts {
+  std::array<uint8_t, 512> touched = {0};
+  std::array<uint8_t, 512> two = {0};
+  std::array<uint8_t, 512> full = {0};
+  // per set of lines: the cells they cover
+  std::array<uint16_t, 256> cells = {0};
+};
+
+constexpr LineCounts calcLineCounts() {
+  LineCounts counts;
+  for (int mask = 0; mask < 512; mask++) {
+    for (int l = 0; l < 8; l++) {
+      int count = std::popcount(static_cast<uint16_t>(mask & s_lineMasks[l]));
+      uint8_t bit = static_cast<uint8_t>(1 << l);
+      if (count > 0)
+        counts.touched[mask] |= bit;
+      if (count == 2)
+        counts.two[mask] |= bit;
+      if (count == 3)
+        counts.full[mask] |= bit;
+    }
+  }
+  for (int lines = 0; lines < 256; lines++) {
+    for (int l = 0; l < 8; l++) {
+      if (lines & (1 << l))
+        counts.cells[lines] |= s_lineMasks[l];
+    }
+  }
+  return counts;
+}
+
+/**
+ * Computes the table of every sub board state. It is built from
+ * the per mask line counts above so that it stays within the
+ * number of steps compilers allow for a constant expression
+ */
+constexpr std::array<SmallBoardInfo, s_smallBoardStates> calcSmallBoardInfos() {
+  constexpr LineCounts counts = calcLineCounts();
+
+  std::array<SmallBoardInfo, s_smallBoardStates> infos;
+  // the cells of the current state, counted up in base 3
+  std::array<int, 9> digits = {0};
+  std::array<int, 2> masks = {0, 0};
+  for (int idx = 0; idx < s_smallBoardStates; idx++) {
+    SmallBoardInfo& info = infos[idx];
+    for (int side = 0; side < 2; side++) {
+      int ours = masks[side];
+      int theirs = masks[1 - side];
+      info.openLines[side] = static_cast<uint8_t>(8 - std::popcount(counts.touched[theirs]));
+      // the third cell of a line with two of our pieces is either empty or theirs
+      int threatLines = counts.two[ours] & ~counts.touched[theirs] & 0xFF;
+      info.threats[side] = static_cast<uint8_t>(std::popcount(static_cast<uint8_t>(threatLines)));
+      info.winningCells[side] = static_cast<uint16_t>(counts.cells[threatLines] & ~ours);
+    }
+    if (counts.full[masks[0]])
+      info.status = GameStatus::XWins;
+    else if (counts.full[masks[1]])
+      info.status = GameStatus::OWins;
+    else if ((masks[0] | masks[1]) == s_fullCellMask)
+      info.status = GameStatus::Draw;
+
+    // next state: empty -> X -> O -> empty with a carry to the next cell
+    for (int cell = 0; cell < 9; cell++) {
+      int bit = 1 << cell;
+      if (digits[cell] == 0) {
+        digits[cell] = 1;
+        masks[0] |= bit;
+        break;
+      }
+      if (digits[cell] == 1) {
+        digits[cell] = 2;
+        masks[0] &= ~bit;
+        masks[1] |= bit;
+        break;
+      }
+      digits[cell] = 0;
+      masks[1] &= ~bit;
+    }
+  }
+  return infos;
+}
+
+constinit const std::array<uint16_t, 512> s_base3 = calcBase3();
+constinit const std::array<SmallBoardInfo, s_smallBoardStates> s_smallBoardInfos = calcSmallBoardInfos();
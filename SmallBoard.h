@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Board.h"
+
+// number of ways to fill a 3x3 board with X, O and empty cells
+constexpr int s_smallBoardStates = 19683;
+// every cell of a 3x3 board
+constexpr uint16_t s_fullCellMask = 0b111111111;
+
+/**
+ * Everything the engine needs to know about a single sub board,
+ * precomputed by the compiler for each of its s_smallBoardStates states.
+ * The arrays are indexed by player, X first.
+ */
+struct SmallBoardInfo {
+  // a board with a line of both players counts as won by X,
+  // which cannot happen in a real game
+  GameStatus status = GameStatus::InProgress;
+  // lines without any piece of the opponent
+  std::array<uint8_t, 2> openLines = {0, 0};
+  // lines with two pieces of the player and an empty cell
+  std::array<uint8_t, 2> threats = {0, 0};
+  // empty cells that complete a line of the player, bit i is cell i
+  std::array<uint16_t, 2> winningCells = {0, 0};
+};
+
+// maps a 9 bit cell mask to the base 3 number with the same digits
+extern const std::array<uint16_t, 512> s_base3;
+// indexed by the base 3 number where each digit is a cell: 0 empty, 1 X, 2 O
+extern const std::array<SmallBoardInfo, s_smallBoardStates> s_smallBoardInfos;
+
+/**
+ * @param xMask the cells occupied by X, bit i is cell i
+ * @param oMask the cells occupied by O
+ */
+inline const SmallBoardInfo& GetSmallBoardInfo(uint16_t xMask, uint16_t oMask) {
+  return s_smallBoardInfos[s_base3[xMask] + 2 * s_base3[oMask]];
+}
+inline const SmallBoardInfo& GetSmallBoardInfo(const Board& board, int boardPosition) {
+  return GetSmallBoardInfo(board.GetCellMask(PlayerSymbol::X, boardPosition),
+                           board.GetCellMask(PlayerSymbol::O, boardPosition));
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+template <typename T>
+class Task;
+
+// what the promises of every Task have in common
+struct TaskPromiseBase {
+  // resumed once the task is done, whoever awaited it
+  std::coroutine_handle<> continuation = std::noop_coroutine();
+  std::exception_ptr exception;
+
+  struct FinalAwaiter {
+    bool await_ready() const noexcept { return false; }
+    // hands the thread over to the awaiting coroutine without growing the stack
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+      return handle.promise().continuation;
+    }
+    void await_resume() const noexcept {}
+  };
+
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+  FinalAwaiter final_suspend() const noexcept { return {}; }
+  void unhandled_exception() { exception = std::current_exception(); }
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase {
+  std::optional<T> value;
+
+  Task<T> get_return_object();
+  void return_value(T result) { value.emplace(std::move(result)); }
+  T TakeResult() {
+    if (exception)
+      std::rethrow_exception(exception);
+    return std::move(*value);
+  }
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+  Task<void> get_return_object();
+  void return_void() const noexcept {}
+  void TakeResult() const {
+    if (exception)
+      std::rethrow_exception(exception);
+  }
+};
+
+/**
+ * Coroutine computing a T, started when it is first awaited. The
+ * awaiting coroutine is resumed on the thread that finishes the task,
+ * exceptions thrown by the task are rethrown to it.
+ *
+ *   Task<Move> Think() { co_return move; }
+ *   Task<void> Play() { Move move = co_await Think(); }
+ *
+ * GameScheduler runs the outermost tasks on its threads.
+ */
+template <typename T>
+class [[nodiscard]] Task {
+public:
+  using promise_type = TaskPromise<T>;
+
+  Task(Task&& other) noexcept
+      : m_handle(std::exchange(other.m_handle, nullptr)) {}
+  Task& operator=(Task&& other) noexcept {
+    if (this != &other) {
+      if (m_handle)
+        m_handle.destroy();
+      m_handle = std::exchange(other.m_handle, nullptr);
+    }
+    return *this;
+  }
+  ~Task() {
+    if (m_handle)
+      m_handle.destroy();
+  }
+
+  bool await_ready() const noexcept { return false; }
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+    m_handle.promise().continuation = awaiting;
+    return m_handle;
+  }
+  T await_resume() { return m_handle.promise().TakeResult(); }
+
+private:
+  friend promise_type;
+  explicit Task(std::coroutine_handle<promise_type> handle)
+      : m_handle(handle) {}
+
+  std::coroutine_handle<promise_type> m_handle;
+};
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() {
+  return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+  return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
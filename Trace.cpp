@@ -0,0 +1,120 @@
+#include "pch.h"
+#include "Trace.h"
+
+namespace Trace {
+
+struct Event {
+  const char* name;
+  int64_t start;
+  int64_t end;
+};
+
+struct ThreadBuffer {
+  static constexpr std::size_t s_capacity = 1 << 16;
+
+  int tid = 0;
+  std::string name;
+  // allocated by the first event, threads that only get a name stay small
+  std::vector<Event> events;
+  // total number of events recorded, the ring holds the last s_capacity
+  std::size_t count = 0;
+};
+
+static std::atomic<bool> s_enabled = false;
+static std::string s_outputPath;
+static const std::chrono::steady_clock::time_point s_epoch = std::chrono::steady_clock::now();
+
+// buffers are owned here so they outlive the threads that wrote them
+static std::mutex s_buffersMutex;
+static std::vector<std::unique_ptr<ThreadBuffer>> s_buffers;
+static thread_local ThreadBuffer* t_buffer = nullptr;
+
+static ThreadBuffer& GetThreadBuffer() {
+  if (!t_buffer) {
+    // only taken once per thread
+    std::lock_guard<std::mutex> lock(s_buffersMutex);
+    s_buffers.push_back(std::make_unique<ThreadBuffer>());
+    t_buffer = s_buffers.back().get();
+    t_buffer->tid = static_cast<int>(s_buffers.size());
+  }
+  return *t_buffer;
+}
+
+void Start(const std::string& outputPath) {
+#ifndef ETTT_TRACING
+  SPDLOG_WARN("Tracing requested but not compiled in, configure with -DEXTREME_TTT_TRACING=ON");
+#endif
+  s_outputPath = outputPath;
+  s_enabled = true;
+  SPDLOG_INFO("Recording trace to {}", outputPath);
+}
+
+bool IsEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+int64_t Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - s_epoch)
+      .count();
+}
+
+void SetThreadName(const char* name) { GetThreadBuffer().name = name; }
+
+void Record(const char* name, int64_t startNs, int64_t endNs) {
+  ThreadBuffer& buffer = GetThreadBuffer();
+  if (buffer.events.empty())
+    buffer.events.resize(ThreadBuffer::s_capacity);
+  buffer.events[buffer.count % ThreadBuffer::s_capacity] = {name, startNs, endNs};
+  buffer.count++;
+}
+
+// escapes the few characters that can show up in span and thread names
+static std::string EscapeJson(const std::string& str) {
+  std::string escaped;
+  for (char c : str) {
+    if (c == '"' || c == '\\')
+      escaped += '\\';
+    escaped += c;
+  }
+  return escaped;
+}
+
+void Stop() {
+  if (!s_enabled.exchange(false))
+    return;
+
+  std::ofstream out(s_outputPath);
+  if (!out) {
+    SPDLOG_ERROR("Could not open trace file {}", s_outputPath);
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(s_buffersMutex);
+  std::size_t written = 0;
+  out << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  auto separator = [&]() -> const char* {
+    return std::exchange(first, false) ? "\n" : ",\n";
+  };
+  for (const auto& buffer : s_buffers) {
+    if (!buffer->name.empty()) {
+      out << separator() << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << buffer->tid
+          << R"(,"args":{"name":")" << EscapeJson(buffer->name) << "\"}}";
+    }
+
+    std::size_t size = std::min(buffer->count, ThreadBuffer::s_capacity);
+    for (std::size_t i = buffer->count - size; i < buffer->count; i++) {
+      const Event& event = buffer->events[i % ThreadBuffer::s_capacity];
+      // timestamps are in microseconds
+      out << separator() << R"({"name":")" << EscapeJson(event.name)
+          << R"(","ph":"X","pid":1,"tid":)" << buffer->tid
+          << ",\"ts\":" << event.start / 1000.0
+          << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+    }
+    written += size;
+  }
+  out << "\n]}\n";
+
+  SPDLOG_INFO("Wrote {} trace events to {}", written, s_outputPath);
+}
+
+} // namespace Trace
@@ -0,0 +1,68 @@
+#pragma once
+
+/**
+ * Scoped trace events exported in the Chrome trace event format
+ * (load the file in chrome://tracing or https://ui.perfetto.dev).
+ *
+ * Spans are only compiled in when ETTT_TRACING is defined (cmake option
+ * EXTREME_TTT_TRACING), otherwise the macros expand to nothing. When
+ * compiled in, recording still has to be switched on at run time with
+ * Trace::Start, until then a span costs a single relaxed atomic load.
+ *
+ * Every thread records into its own ring buffer, so recording never
+ * takes a lock. When a buffer is full the oldest events are overwritten.
+ */
+namespace Trace {
+
+/**
+ * Starts recording events
+ *
+ * @param outputPath the file the events are written to by Stop
+ */
+void Start(const std::string& outputPath);
+
+/**
+ * Stops recording and writes every buffered event to the output file.
+ * Threads that recorded events should be done by the time this is called.
+ */
+void Stop();
+
+bool IsEnabled();
+
+/**
+ * Names the calling thread in the exported trace
+ */
+void SetThreadName(const char* name);
+
+// records a complete event, timestamps come from Now()
+void Record(const char* name, int64_t startNs, int64_t endNs);
+int64_t Now();
+
+class ScopedSpan {
+public:
+  explicit ScopedSpan(const char* name)
+      : m_name(IsEnabled() ? name : nullptr), m_start(m_name ? Now() : 0) {}
+  ~ScopedSpan() {
+    if (m_name)
+      Record(m_name, m_start, Now());
+  }
+  ScopedSpan(const ScopedSpan&) = delete;
+  ScopedSpan& operator=(const ScopedSpan&) = delete;
+
+private:
+  const char* m_name;
+  int64_t m_start;
+};
+
+} // namespace Trace
+
+#ifdef ETTT_TRACING
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+// name must be a string literal, only the pointer is stored
+#define TRACE_SCOPE(name) ::Trace::ScopedSpan TRACE_CONCAT(traceSpan_, __LINE__)(name)
+#define TRACE_THREAD_NAME(name) ::Trace::SetThreadName(name)
+#else
+#define TRACE_SCOPE(name)
+#define TRACE_THREAD_NAME(name)
+#endif
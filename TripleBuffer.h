@@ -0,0 +1,59 @@
+#pragma once
+
+/**
+ * Single producer / single consumer channel that always hands the
+ * consumer the most recently published value without ever blocking
+ * either side.
+ *
+ * Three slots are used: the producer owns the back slot, the consumer
+ * owns the front slot and the middle slot is exchanged atomically between
+ * them. Neither side ever touches a slot owned by the other one, so a
+ * published value can never be observed half written.
+ */
+template <typename T>
+class TripleBuffer {
+public:
+  TripleBuffer() = default;
+  TripleBuffer(const TripleBuffer&) = delete;
+  TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+  /**
+   * Producer side: copies the value in the back slot and makes it
+   * available to the consumer. Never waits on the consumer.
+   *
+   * @param value the value to publish
+   */
+  void Publish(const T& value) {
+    m_buffers[m_back] = value;
+    // hand the back slot over and take the middle one in exchange
+    m_back = m_middle.exchange(m_back | s_freshBit, std::memory_order_acq_rel) & s_indexMask;
+  }
+
+  /**
+   * Consumer side: returns the latest published value. If nothing new
+   * was published since the last call, the same value is returned again.
+   * The reference stays valid until the next call to Read.
+   *
+   * @return the most recently published value
+   */
+  const T& Read() {
+    if (m_middle.load(std::memory_order_relaxed) & s_freshBit) {
+      m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & s_indexMask;
+    }
+    return m_buffers[m_front];
+  }
+
+private:
+  static constexpr uint8_t s_indexMask = 0b011;
+  static constexpr uint8_t s_freshBit = 0b100;
+
+  std::array<T, 3> m_buffers{};
+
+  // only touched by the producer
+  uint8_t m_back = 0;
+  // index of the shared slot, with the fresh bit set when it holds
+  // a value the consumer has not read yet
+  alignas(64) std::atomic<uint8_t> m_middle{1};
+  // only touched by the consumer
+  alignas(64) uint8_t m_front = 2;
+};
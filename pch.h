@@ -11,10 +11,15 @@
 #include <algorithm>
 #include <array>
 #include <atomic>
+#include <bit>
 #include <chrono>
 #include <cmath>
 #include <condition_variable>
+#include <coroutine>
+#include <cstring>
 #include <ctime>
+#include <deque>
+#include <filesystem>
 #include <fstream>
 #include <functional>
 #include <future>
@@ -22,13 +27,16 @@
 #include <iostream>
 #include <map>
 #include <memory>
+#include <memory_resource>
 #include <mutex>
 #include <optional>
+#include <queue>
 #include <random>
 #include <set>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <type_traits>
 #include <unordered_map>
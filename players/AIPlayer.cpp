@@ -1,121 +1,726 @@
 #include "pch.h"
 #include "AIPlayer.h"
+#include "../Allocations.h"
+#include "../Logging.h"
+#include "SmallBoard.h"
+#include "Trace.h"
 
-int AIPlayer::attempted = 0;
-int AIPlayer::found = 0;
-std::unordered_map<Board, Score> AIPlayer::s_scoreMap;
+std::mutex AIPlayer::s_totalStatsMutex;
+SearchStats AIPlayer::s_totalStats;
+std::mutex AIPlayer::s_pendingScoresMutex;
+std::map<std::string, AIPlayer::PendingScores> AIPlayer::s_pendingScores;
 
-Move AIPlayer::GetMove() {
-  std::vector<std::pair<Move, Board>> boards = GetChildrenBoards(m_mainBoard);
-  Score bestValue = std::numeric_limits<Score>::min();
-  Move bestMove;
+// every search thread counts into its own copy,
+// they are merged once the search is over
+static thread_local SearchStats t_searchStats;
+
+AIConfig AIConfig::Parse(const std::string& str) {
+  AIConfig config;
+  std::stringstream ss(str);
+  std::string entry;
+  while (std::getline(ss, entry, ',')) {
+    if (entry.empty())
+      continue;
+    std::size_t eq = entry.find('=');
+    if (eq == std::string::npos)
+      throw std::invalid_argument("Expected key=value in engine config: " + entry);
+    std::string key = entry.substr(0, eq);
+    std::string value = entry.substr(eq + 1);
+
+    if (key == "depth") {
+      int depth = std::stoi(value);
+      if (depth < 0 || depth > 80)
+        throw std::invalid_argument("Invalid depth: " + value);
+      config.depth = static_cast<uint8_t>(depth);
+    } else if (key == "pvs") {
+      config.pvs = std::stoi(value) != 0;
+    } else if (key == "aspiration") {
+      config.aspirationWindow = std::max(0, std::stoi(value));
+    } else if (key == "lmr") {
+      config.lmr = std::stoi(value) != 0;
+    } else if (key == "lmr_depth") {
+      config.lmrMinDepth = std::max(1, std::stoi(value));
+    } else if (key == "lmr_moves") {
+      config.lmrFullMoves = std::max(1, std::stoi(value));
+    } else if (key == "lmr_reduction") {
+      config.lmrReduction = std::max(1, std::stoi(value));
+    } else if (key == "extension") {
+      config.extension = std::max(0, std::stoi(value));
+    } else if (key == "weights") {
+      config.weightsPath = value;
+    } else if (key == "nnue") {
+      config.nnuePath = value;
+    } else if (key == "book") {
+      config.bookPath = value;
+    } else if (key == "cache") {
+      config.cachePath = value;
+    } else if (key == "cache_size") {
+      config.cacheMaxEntries = static_cast<std::size_t>(std::max(0ll, std::stoll(value)));
+    } else if (key == "eval_batch") {
+      config.evalBatch = static_cast<std::size_t>(std::clamp(std::stoi(value), 1, 4096));
+    } else if (key == "eval_batch_us") {
+      config.evalBatchLatency = std::chrono::microseconds(std::max(0ll, std::stoll(value)));
+    } else if (key == "multipv") {
+      config.multiPv = std::clamp(std::stoi(value), 1, 9 * 9);
+    } else if (key == "shared_cache") {
+      config.sharedCacheEntries = static_cast<std::size_t>(std::max(0ll, std::stoll(value)));
+    } else {
+      throw std::invalid_argument("Unknown engine config key: " + key);
+    }
+  }
+  return config;
+}
 
-  Score alpha = std::numeric_limits<Score>::min();
-  Score beta = std::numeric_limits<Score>::max();
+std::ostream& operator<<(std::ostream& os, const AIConfig& config) {
+  os << "depth=" << static_cast<int>(config.depth)
+     << ",pvs=" << config.pvs
+     << ",aspiration=" << config.aspirationWindow
+     << ",lmr=" << config.lmr
+     << ",lmr_depth=" << config.lmrMinDepth
+     << ",lmr_moves=" << config.lmrFullMoves
+     << ",lmr_reduction=" << config.lmrReduction
+     << ",extension=" << config.extension;
+  if (!config.weightsPath.empty())
+    os << ",weights=" << config.weightsPath;
+  if (!config.nnuePath.empty())
+    os << ",nnue=" << config.nnuePath;
+  if (!config.bookPath.empty())
+    os << ",book=" << config.bookPath;
+  if (!config.cachePath.empty())
+    os << ",cache=" << config.cachePath << ",cache_size=" << config.cacheMaxEntries;
+  if (config.sharedCacheEntries > 0)
+    os << ",shared_cache=" << config.sharedCacheEntries;
+  if (config.evalBatch > 1)
+    os << ",eval_batch=" << config.evalBatch << ",eval_batch_us=" << config.evalBatchLatency.count();
+  if (config.multiPv > 1)
+    os << ",multipv=" << config.multiPv;
+  return os;
+}
 
-  PlayerSymbol player = m_mainBoard.GetCurrentPlayer();
-  SPDLOG_DEBUG("Player is {}", player);
-  int weight = -static_cast<int>(player);
-  SPDLOG_DEBUG("Weight is {}", weight);
+// the moves of a node are tried in this order
+enum class MoveKind : uint8_t {
+  // finishes the sub board it is played in
+  ClosesBoard,
+  // lines up two pieces of a sub board next to an empty cell
+  Threat,
+  Quiet,
+  // sends the opponent to a finished sub board, so it may play anywhere
+  FreesOpponent,
+};
 
-  SPDLOG_DEBUG("Analyzing {} possible moves (higher is better)", boards.size());
-  for (const auto& [move, board] : boards) {
-    if (m_isTerminated)
-      break;
+// classifies a move played by Us in parent
+template <PlayerSymbol Us>
+static MoveKind ClassifyMove(const Board& parent, const Move& move, const Board& child) {
+  int boardPosition = move.m_boardPosition;
+  if (child.GetBigBoard()[boardPosition] != GameStatus::InProgress)
+    return MoveKind::ClosesBoard;
+  constexpr int side = Us == PlayerSymbol::X ? 0 : 1;
+  if (GetSmallBoardInfo(child, boardPosition).threats[side] > GetSmallBoardInfo(parent, boardPosition).threats[side])
+    return MoveKind::Threat;
+  if (!child.IsGameOver() && child.GetForcedBoard() < 0)
+    return MoveKind::FreesOpponent;
+  return MoveKind::Quiet;
+}
+
+// networks and books are loaded once per file, no matter how many players use them
+template <typename T>
+static std::shared_ptr<const T> LoadShared(const std::string& path) {
+  static std::mutex mutex;
+  static std::map<std::string, std::shared_ptr<const T>> loaded;
+  std::lock_guard<std::mutex> lock(mutex);
+  std::shared_ptr<const T>& value = loaded[path];
+  if (!value)
+    value = T::Load(path);
+  return value;
+}
+
+// players configured with a shared cache use the same one while any of them lives
+static std::shared_ptr<SharedScoreCache> GetSharedScoreCache(std::size_t entries, uint64_t evalStamp) {
+  static std::mutex mutex;
+  static std::map<std::pair<std::size_t, uint64_t>, std::weak_ptr<SharedScoreCache>> caches;
+  std::lock_guard<std::mutex> lock(mutex);
+  std::weak_ptr<SharedScoreCache>& weak = caches[{entries, evalStamp}];
+  std::shared_ptr<SharedScoreCache> cache = weak.lock();
+  if (!cache) {
+    cache = std::make_shared<SharedScoreCache>(entries, evalStamp);
+    weak = cache;
+  }
+  return cache;
+}
 
-    SPDLOG_DEBUG("Analyzing move {}", move);
-    Score value = -Negamax(board, m_depth, alpha, beta, weight);
-    SPDLOG_DEBUG("\t --> score {} (best value: {})", value, bestValue);
-    if (value > bestValue) {
-      SPDLOG_DEBUG("New best move {}", move);
-      bestValue = value;
-      bestMove = move;
+// players batching the same network with the same settings share a batcher
+static std::shared_ptr<EvalBatcher> GetEvalBatcher(const std::string& nnuePath, std::shared_ptr<const Nnue> nnue,
+                                                   std::size_t batchSize, std::chrono::microseconds maxLatency) {
+  static std::mutex mutex;
+  static std::map<std::tuple<std::string, std::size_t, int64_t>, std::weak_ptr<EvalBatcher>> batchers;
+  std::lock_guard<std::mutex> lock(mutex);
+  std::weak_ptr<EvalBatcher>& weak = batchers[{nnuePath, batchSize, maxLatency.count()}];
+  std::shared_ptr<EvalBatcher> batcher = weak.lock();
+  if (!batcher) {
+    batcher = std::make_shared<EvalBatcher>(std::move(nnue), batchSize, maxLatency);
+    weak = batcher;
+  }
+  return batcher;
+}
+
+AIPlayer::AIPlayer(const AIConfig& config)
+    : AIPlayer(config, nullptr) {}
+
+AIPlayer::AIPlayer(const AIConfig& config, std::shared_ptr<SharedScoreCache> sharedScores)
+    : m_config(config), m_sharedScores(std::move(sharedScores)) {
+  if (!config.weightsPath.empty()) {
+    std::optional<EvalWeights> weights = EvalWeights::Load(config.weightsPath);
+    if (!weights) {
+      SPDLOG_CRITICAL("Failed to load the evaluation weights {}", config.weightsPath);
+      abort();
+    }
+    m_weights = *weights;
+  }
+  if (!config.nnuePath.empty()) {
+    m_nnue = LoadShared<Nnue>(config.nnuePath);
+    if (!m_nnue) {
+      SPDLOG_CRITICAL("Failed to load the network {}", config.nnuePath);
+      abort();
+    }
+    if (config.evalBatch > 1)
+      m_evalBatcher = GetEvalBatcher(config.nnuePath, m_nnue, config.evalBatch, config.evalBatchLatency);
+  }
+  if (!config.bookPath.empty()) {
+    m_book = LoadShared<OpeningBook>(config.bookPath);
+    if (!m_book) {
+      SPDLOG_CRITICAL("Failed to load the book {}", config.bookPath);
+      abort();
+    }
+  }
+  if (!config.cachePath.empty() && std::filesystem::exists(config.cachePath)) {
+    // a missing or stale cache only means starting cold, it is rewritten on save
+    m_savedScores = LoadShared<ScoreCache>(config.cachePath);
+    if (m_savedScores && m_savedScores->GetEvalStamp() != GetEvalStamp(m_weights)) {
+      SPDLOG_WARN("Ignoring the score cache {}, it was made with another evaluation", config.cachePath);
+      m_savedScores = nullptr;
+    }
+  }
+  if (m_sharedScores && m_sharedScores->GetEvalStamp() != GetEvalStamp(m_weights)) {
+    SPDLOG_CRITICAL("The shared score cache was made for another evaluation");
+    abort();
+  }
+  if (!m_sharedScores && config.sharedCacheEntries > 0)
+    m_sharedScores = GetSharedScoreCache(config.sharedCacheEntries, GetEvalStamp(m_weights));
+}
+
+SearchStats AIPlayer::GetTotalSearchStats() {
+  std::lock_guard<std::mutex> lock(s_totalStatsMutex);
+  return s_totalStats;
+}
+
+void AIPlayer::FlushScores() {
+  if (m_config.cachePath.empty() || m_scoreMap.empty())
+    return;
+
+  const uint64_t evalStamp = GetEvalStamp(m_weights);
+  std::lock_guard<std::mutex> lock(s_pendingScoresMutex);
+  auto [it, inserted] = s_pendingScores.try_emplace(m_config.cachePath, PendingScores{evalStamp, m_config.cacheMaxEntries, {}});
+  PendingScores& pending = it->second;
+  if (pending.evalStamp != evalStamp) {
+    SPDLOG_WARN("Not saving scores to {}, another evaluation already uses it", m_config.cachePath);
+    return;
+  }
+  // the smallest keys are kept, as ScoreCache::Save does, so the sample
+  // does not depend on the order of the map or of the players flushing
+  for (const auto& [board, score] : m_scoreMap) {
+    pending.scores.emplace(board.GetKey(), score);
+    if (pending.scores.size() > pending.maxEntries)
+      pending.scores.erase(std::prev(pending.scores.end()));
+  }
+}
+
+void AIPlayer::SaveScoreCaches() {
+  std::lock_guard<std::mutex> lock(s_pendingScoresMutex);
+  for (auto& [path, pending] : s_pendingScores) {
+    std::vector<ScoreCache::Entry> entries;
+    entries.reserve(pending.scores.size());
+    for (const auto& [key, score] : pending.scores)
+      entries.push_back({key, score});
+    // the scores already in the file are kept unless another evaluation made them. The file
+    // is read again, the snapshot the players loaded misses what other processes saved since
+    std::shared_ptr<const ScoreCache> saved = std::filesystem::exists(path) ? ScoreCache::Load(path) : nullptr;
+    if (saved && saved->GetEvalStamp() == pending.evalStamp) {
+      std::vector<ScoreCache::Entry> savedEntries = saved->GetEntries();
+      entries.insert(entries.end(), savedEntries.begin(), savedEntries.end());
+    }
+    if (ScoreCache::Save(path, pending.evalStamp, std::move(entries), pending.maxEntries))
+      SPDLOG_INFO("Saved score cache {}", path);
+  }
+  s_pendingScores.clear();
+}
+
+// one structured event per move played by a player, see Logging.h
+static void LogMoveEvent(const char* kind, const Board& board, const Move& move, Score score, const SearchStats& stats,
+                         const std::vector<Move>& pv) {
+  spdlog::logger* events = Logging::GetEvents();
+  if (!events)
+    return;
+  std::string line;
+  for (const Move& pvMove : pv)
+    line += fmt::format("{}{}{}", line.empty() ? "" : " ", pvMove.m_boardPosition, pvMove.m_cellPosition);
+  events->info(R"("event":"{}","player":"{}","position":"{}","move":"{}{}","score":{},"depth":{},"nodes":{},)"
+               R"("time_us":{},"pv":"{}")",
+               kind, board.GetCurrentPlayer(), board.ToNotation(), move.m_boardPosition, move.m_cellPosition, score,
+               stats.depth, stats.nodes, std::chrono::duration_cast<std::chrono::microseconds>(stats.elapsed).count(),
+               line);
+}
+
+Move AIPlayer::GetMove() {
+  TRACE_SCOPE("AIPlayer::GetMove");
+  SPDLOG_DEBUG("Player is {}", m_mainBoard.GetCurrentPlayer());
+
+  if (m_book) {
+    if (std::optional<OpeningBook::Hit> hit = m_book->Probe(m_mainBoard)) {
+      m_lastSearchStats = SearchStats();
+      m_lastScore = hit->score;
+      SPDLOG_INFO("book move={} score={} depth={}", hit->move, hit->score, hit->depth);
+      LogMoveEvent("book", m_mainBoard, hit->move, hit->score, m_lastSearchStats, {hit->move});
+      m_mainBoard.Play(hit->move);
+      return hit->move;
+    }
+  }
+
+  SearchLimits limits;
+  std::optional<TimeManager> timeManager;
+  if (m_timeLeft) {
+    // the clock decides how deep to go
+    timeManager.emplace(m_mainBoard, m_timeLeft->first, m_timeLeft->second);
+    limits.depth = 80;
+    limits.time = timeManager->GetHardBudget();
+    limits.timeManager = &*timeManager;
+    SPDLOG_DEBUG("time left={}ms soft={}ms hard={}ms", m_timeLeft->first.count(),
+                 timeManager->GetSoftBudget().count(), timeManager->GetHardBudget().count());
+    m_timeLeft = std::nullopt;
+  }
+  std::optional<SearchResult> result = Analyze(m_mainBoard, limits);
+  if (!result) {
+    SPDLOG_ERROR("Asked for a move in a finished game");
+    return Move(0, 0);
+  }
+  SPDLOG_INFO("search move={} score={} {}", result->move, result->score, result->stats);
+  LogMoveEvent("search", m_mainBoard, result->move, result->score, result->stats, result->pv);
+  if (result->lines.size() > 1 && spdlog::should_log(spdlog::level::info)) {
+    for (std::size_t i = 0; i < result->lines.size(); i++) {
+      const PvLine& line = result->lines[i];
+      std::string pv;
+      for (const Move& move : line.pv)
+        pv += fmt::format(" {}", move);
+      SPDLOG_INFO("line {}: move={} score={} pv={}", i + 1, line.move, line.score, pv);
     }
   }
 
   // apply the move to our main board
-  m_mainBoard.Play(bestMove);
-  return bestMove;
+  m_mainBoard.Play(result->move);
+  return result->move;
+}
+
+std::optional<SearchResult> AIPlayer::Analyze(const Board& board, const SearchLimits& limits,
+                                              const IterationCallback& onIteration) {
+  TRACE_SCOPE("AIPlayer::Analyze");
+  t_searchStats = SearchStats();
+  Allocations::Scope allocations;
+  m_searchStart = std::chrono::steady_clock::now();
+  m_limits = limits;
+  m_maxDepth = limits.depth >= 0 ? limits.depth : m_config.depth;
+  m_multiPv = std::clamp(limits.multiPv > 0 ? limits.multiPv : m_config.multiPv, 1, 9 * 9);
+  m_isStopped = false;
+
+  // the search is compiled once for each player, so
+  // it never has to check whose turn it is
+  std::vector<RootMove> rootMoves;
+  Score bestValue = board.GetCurrentPlayer() == PlayerSymbol::X ? Search<PlayerSymbol::X>(board, rootMoves, onIteration)
+                                                                : Search<PlayerSymbol::O>(board, rootMoves, onIteration);
+  if (rootMoves.empty())
+    return std::nullopt;
+
+  t_searchStats.elapsed = std::chrono::steady_clock::now() - m_searchStart;
+  t_searchStats.allocations = allocations.Get().allocations;
+  t_searchStats.allocatedBytes = allocations.Get().bytes;
+  m_lastScore = bestValue;
+  m_lastSearchStats = t_searchStats;
+  {
+    std::lock_guard<std::mutex> lock(s_totalStatsMutex);
+    s_totalStats.Merge(m_lastSearchStats);
+  }
+
+  return MakeResult(rootMoves, bestValue);
+}
+
+SearchResult AIPlayer::MakeResult(const std::vector<RootMove>& rootMoves, Score bestValue) const {
+  SearchResult result{rootMoves.front().move, bestValue, {}, t_searchStats, {}};
+  for (std::size_t i = 0; i < std::min<std::size_t>(m_multiPv, rootMoves.size()); i++) {
+    const RootMove& rootMove = rootMoves[i];
+    // only a stopped first iteration leaves a move without its line
+    PvLine& line = result.lines.emplace_back(rootMove.move, rootMove.score, rootMove.pv);
+    if (line.pv.empty())
+      line.pv.push_back(line.move);
+  }
+  result.pv = result.lines.front().pv;
+  return result;
+}
+
+void AIPlayer::CheckLimits() {
+  if (m_isTerminated) {
+    m_isStopped = true;
+    return;
+  }
+  // the first iteration always completes, so there is a move to return
+  if (t_searchStats.depth == 0)
+    return;
+  if (m_limits.nodes > 0 && t_searchStats.nodes >= m_limits.nodes)
+    m_isStopped = true;
+  if (m_limits.stop && m_limits.stop->load(std::memory_order_relaxed))
+    m_isStopped = true;
+  if (m_limits.time.count() > 0 && std::chrono::steady_clock::now() - m_searchStart >= m_limits.time)
+    m_isStopped = true;
+}
+
+void AIPlayer::UpdatePv(int ply, const Move& move) {
+  std::array<Move, s_maxPly>& pv = m_pvTable[ply];
+  const std::array<Move, s_maxPly>& childPv = m_pvTable[ply + 1];
+  pv[ply] = move;
+  std::copy(childPv.begin() + ply + 1, childPv.begin() + m_pvLength[ply + 1], pv.begin() + ply + 1);
+  m_pvLength[ply] = m_pvLength[ply + 1];
 }
 
 void AIPlayer::ReceiveMove(const Move& move) {
   m_mainBoard.Play(move);
 }
 
-std::vector<std::pair<Move, Board>> AIPlayer::GetChildrenBoards(const Board& board) {
-  // TODO: can this be optimized
-  std::vector<std::pair<Move, Board>> boards;
+template <PlayerSymbol Us>
+void AIPlayer::GetChildrenBoards(const Board& board, std::vector<std::pair<Move, Board>>& boards) {
+  boards.clear();
+  // there are at most 81 children, so no later call grows it
+  boards.reserve(9 * 9);
 
   for (int boardPosition = 0; boardPosition < 9; boardPosition++) {
     for (int cellPosition = 0; cellPosition < 9; cellPosition++) {
       Move move(boardPosition, cellPosition);
       if (board.IsMoveLegal(move)) {
         Board board_copy = board;
-        board_copy.Play(move);
+        board_copy.Play<Us>(move);
         boards.push_back({move, board_copy});
       }
     }
   }
+}
+
+template <PlayerSymbol Us>
+Score AIPlayer::Search(const Board& board, std::vector<RootMove>& rootMoves, const IterationCallback& onIteration) {
+  Nnue::Accumulator rootAcc;
+  if (m_nnue)
+    m_nnue->Refresh(board, rootAcc);
+
+  GetChildrenBoards<Us>(board, m_children[0]);
+  for (auto& [move, child] : m_children[0]) {
+    RootMove& rootMove = rootMoves.emplace_back();
+    rootMove.move = move;
+    rootMove.board = child;
+    if (m_nnue)
+      m_nnue->Update(board, move, child, rootAcc, rootMove.acc);
+  }
+  if (rootMoves.empty())
+    return 0;
+
+  SPDLOG_DEBUG("Analyzing {} possible moves (higher is better)", rootMoves.size());
+  t_searchStats.nodes++;
+  t_searchStats.RecordExpansion(0, rootMoves.size());
+
+  // iterative deepening, every iteration orders the root moves for
+  // the next one and gives it a score to center its window on.
+  // The last iteration searches the children at m_maxDepth
+  Score bestValue = 0;
+  // score and line of each root move after the last completed iteration, in its order
+  std::vector<std::pair<Score, std::vector<Move>>> completed(rootMoves.size(), {-s_infinity, {}});
+  for (int depth = 0; depth <= m_maxDepth; depth++) {
+    TRACE_SCOPE("AIPlayer iteration");
+    // the window is centered on the best score, the other lines would fail low
+    Score value = depth > 0 && m_config.aspirationWindow > 0 && m_multiPv == 1
+                      ? SearchAspiration<Us>(rootMoves, depth, bestValue)
+                      : SearchRoot<Us>(rootMoves, depth, -s_infinity, s_infinity);
+    // an interrupted iteration is incomplete, keep the previous result. It left
+    // some of the moves with a score and line of its own, which do not compare.
+    // Only a terminated player stops the first one, which has nothing to go back to
+    if (IsStopped()) {
+      for (std::size_t i = 0; depth > 0 && i < rootMoves.size(); i++) {
+        rootMoves[i].score = completed[i].first;
+        rootMoves[i].pv.swap(completed[i].second);
+      }
+      break;
+    }
+
+    std::stable_sort(rootMoves.begin(), rootMoves.end(), [](const RootMove& a, const RootMove& b) {
+      return a.score > b.score;
+    });
+    for (std::size_t i = 0; i < rootMoves.size(); i++)
+      completed[i] = {rootMoves[i].score, rootMoves[i].pv};
+    bestValue = value;
+    t_searchStats.depth = depth + 1;
+    SPDLOG_DEBUG("Depth {}: best move {} with score {}", depth + 1, rootMoves.front().move, bestValue);
+    if (onIteration) {
+      t_searchStats.elapsed = std::chrono::steady_clock::now() - m_searchStart;
+      onIteration(MakeResult(rootMoves, bestValue));
+    }
+    if (m_limits.timeManager &&
+        m_limits.timeManager->OnIteration(rootMoves.front().move, std::chrono::steady_clock::now() - m_searchStart))
+      break;
+    // no point in starting an iteration that would be stopped right away
+    CheckLimits();
+    if (IsStopped())
+      break;
+  }
+  return bestValue;
+}
+
+template <PlayerSymbol Us>
+Score AIPlayer::SearchRoot(std::vector<RootMove>& rootMoves, int depth, Score alpha, Score beta) {
+  Score bestValue = -s_infinity;
+  // the m_multiPv best scores of this iteration, best first. A move only needs
+  // an exact score if it beats the worst of them, so that one is the lower bound
+  // of the window once there are enough, which is the best score with a single line
+  std::array<Score, 9 * 9> best;
+  std::size_t bestCount = 0;
+  const std::size_t lines = static_cast<std::size_t>(m_multiPv);
+  for (std::size_t i = 0; i < rootMoves.size(); i++) {
+    if (IsStopped())
+      break;
+
+    TRACE_SCOPE("AIPlayer root move");
+    RootMove& rootMove = rootMoves[i];
+    const Nnue::Accumulator* acc = m_nnue ? &rootMove.acc : nullptr;
+    Score moveAlpha = bestCount == lines ? std::max(alpha, best[lines - 1]) : alpha;
+    Allocations::Scope treeAllocations;
+    const uint64_t scoreMapAllocations = t_searchStats.scoreMapAllocations;
+    Score value = SearchChild<Opponent(Us)>(rootMove.board, acc, depth, 1, moveAlpha, beta, i < lines || !m_config.pvs);
+    if (Allocations::IsTracking()) {
+      t_searchStats.treeAllocations +=
+          treeAllocations.Get().allocations - (t_searchStats.scoreMapAllocations - scoreMapAllocations);
+    }
+    SPDLOG_DEBUG("Move {} --> score {} (best value: {})", rootMove.move, value, bestValue);
+    if (IsStopped())
+      break;
+
+    // the line of a move that does not beat the others is only a bound
+    if (value > moveAlpha || rootMove.pv.empty()) {
+      rootMove.pv.assign(1, rootMove.move);
+      rootMove.pv.insert(rootMove.pv.end(), m_pvTable[1].begin() + 1, m_pvTable[1].begin() + m_pvLength[1]);
+    }
+    rootMove.score = value;
+    bestValue = std::max(bestValue, value);
+    if (bestCount < lines)
+      best[bestCount++] = value;
+    else if (value > best[lines - 1])
+      best[lines - 1] = value;
+    std::sort(best.begin(), best.begin() + bestCount, std::greater<Score>());
+    // only happens when the window is narrowed by the aspiration
+    if (bestCount == lines && best[lines - 1] >= beta)
+      break;
+  }
+  return bestValue;
+}
+
+template <PlayerSymbol Us>
+Score AIPlayer::SearchAspiration(std::vector<RootMove>& rootMoves, int depth, Score previous) {
+  Score delta = m_config.aspirationWindow;
+  Score alpha = std::max(previous - delta, -s_infinity);
+  Score beta = std::min(previous + delta, s_infinity);
+  while (true) {
+    Score value = SearchRoot<Us>(rootMoves, depth, alpha, beta);
+    if (IsStopped())
+      return value;
 
-  return boards;
+    // the score is outside the window, widen it on that side and search again
+    if (value <= alpha && alpha > -s_infinity) {
+      alpha = std::max(value - delta, -s_infinity);
+    } else if (value >= beta && beta < s_infinity) {
+      beta = std::min(value + delta, s_infinity);
+    } else {
+      return value;
+    }
+    t_searchStats.aspirationResearches++;
+    delta *= 4;
+  }
 }
 
-Score AIPlayer::Negamax(const Board& board, int depth, Score alpha, Score beta, int weight) {
+template <PlayerSymbol Us>
+Score AIPlayer::Negamax(const Board& board, const Nnue::Accumulator* acc, int depth, int ply, Score alpha, Score beta) {
   // this function returns the score from the perspective
-  // of the player who's turn it is to play.
+  // of Us, the player who's turn it is to play.
   // The higher the score, the better it is for the player
+  // acc is the accumulator of board when a network is used, nullptr otherwise
+  t_searchStats.nodes++;
+  m_pvLength[ply] = ply;
+  // the clock is only read every few nodes, a stopped search returns a meaningless score
+  if ((t_searchStats.nodes & 1023) == 0)
+    CheckLimits();
+  if (m_isStopped)
+    return 0;
 
   if (depth == 0 || board.IsGameOver()) {
-    Score sa = StaticAnalysis(board);
-    return weight * sa;
+    Score sa = StaticAnalysis(board, acc);
+    if constexpr (Us == PlayerSymbol::X)
+      return sa;
+    else
+      return -sa;
   }
 
-  std::vector<std::pair<Move, Board>> boards = GetChildrenBoards(board);
-  // order moves (might do this later)
-  // std::sort(boards.begin(), boards.end(), [&](const Board& a, const Board& b) {
-  //   return StaticAnalysis(a) > StaticAnalysis(b);
-  // });
+  std::vector<std::pair<Move, Board>>& boards = m_children[ply];
+  GetChildrenBoards<Us>(board, boards);
+  t_searchStats.RecordExpansion(ply, boards.size());
+
+  // there are at most 81 children
+  std::array<MoveKind, 9 * 9> kinds;
+  std::array<uint8_t, 9 * 9> order;
+  for (std::size_t i = 0; i < boards.size(); i++)
+    kinds[i] = ClassifyMove<Us>(board, boards[i].first, boards[i].second);
+  // by kind, in generation order within a kind. A pass per kind sorts as
+  // std::stable_sort would, without the buffer it takes from the heap
+  std::size_t sorted = 0;
+  for (MoveKind kind : {MoveKind::ClosesBoard, MoveKind::Threat, MoveKind::Quiet, MoveKind::FreesOpponent}) {
+    for (std::size_t i = 0; i < boards.size(); i++) {
+      if (kinds[i] == kind)
+        order[sorted++] = static_cast<uint8_t>(i);
+    }
+  }
+
+  Score bestValue = -s_infinity;
+  // the parent's accumulator stays untouched, so undoing a move costs nothing
+  Nnue::Accumulator childAcc;
+  for (std::size_t i = 0; i < boards.size(); i++) {
+    const auto& [move, child] = boards[order[i]];
+    MoveKind kind = kinds[order[i]];
+    bool isFirstMove = i == 0;
+    if (acc)
+      m_nnue->Update(board, move, child, *acc, childAcc);
+    const Nnue::Accumulator* nextAcc = acc ? &childAcc : nullptr;
+
+    int childDepth = depth - 1;
+    // a forcing move gets answered before the static analysis is trusted,
+    // the ply limit keeps a chain of them from going past the deepest iteration
+    bool isForcing = kind == MoveKind::Threat || kind == MoveKind::FreesOpponent;
+    if (isForcing && m_config.extension > 0 && childDepth == 0 && ply <= m_maxDepth) {
+      t_searchStats.extensions++;
+      childDepth += m_config.extension;
+    }
+
+    Score value = -s_infinity;
+    bool reduce = m_config.lmr && kind == MoveKind::Quiet && depth >= m_config.lmrMinDepth &&
+                  static_cast<int>(i) >= m_config.lmrFullMoves;
+    if (reduce) {
+      // a late quiet move is unlikely to be good, only look at it
+      // closely if a shallower null window search says otherwise
+      t_searchStats.lmrReductions++;
+      int reducedDepth = std::max(childDepth - m_config.lmrReduction, 0);
+      value = -Negamax<Opponent(Us)>(child, nextAcc, reducedDepth, ply + 1, -alpha - 1, -alpha);
+      if (value > alpha)
+        t_searchStats.lmrResearches++;
+    }
+    if (!reduce || value > alpha)
+      value = SearchChild<Opponent(Us)>(child, nextAcc, childDepth, ply + 1, alpha, beta, isFirstMove || !m_config.pvs);
 
-  Score bestValue = std::numeric_limits<Score>::min();
-  for (const auto& [_move, child] : boards) {
-    Score value = -Negamax(child, depth - 1, -beta, -alpha, -weight);
     bestValue = std::max(bestValue, value);
-    alpha = std::max(alpha, value);
+    if (value > alpha) {
+      alpha = value;
+      UpdatePv(ply, move);
+    }
     if (alpha >= beta) {
+      t_searchStats.cutoffs++;
+      if (isFirstMove)
+        t_searchStats.firstMoveCutoffs++;
       break;
     }
   }
   return bestValue;
 }
 
+template <PlayerSymbol Them>
+Score AIPlayer::SearchChild(const Board& child, const Nnue::Accumulator* acc, int depth, int ply, Score alpha, Score beta, bool fullWindow) {
+  // returns the score of child, where Them is to move, from the parent's point of view
+  if (fullWindow)
+    return -Negamax<Them>(child, acc, depth, ply, -beta, -alpha);
+
+  // the first move is assumed to be the best, the others
+  // only get a null window and are searched again if they beat it
+  Score value = -Negamax<Them>(child, acc, depth, ply, -alpha - 1, -alpha);
+  if (value > alpha && value < beta) {
+    t_searchStats.pvsResearches++;
+    value = -Negamax<Them>(child, acc, depth, ply, -beta, -alpha);
+  }
+  return value;
+}
+
 // https://en.wikipedia.org/wiki/Negamax
 
-Score AIPlayer::StaticAnalysis(const Board& board) {
+Score AIPlayer::StaticAnalysis(const Board& board, const Nnue::Accumulator* acc) {
+  t_searchStats.leafEvaluations++;
+  // the network is cheaper than a cache lookup, and its scores
+  // must not end up in the cache of the hand written evaluation
+  if (acc && !board.IsGameOver()) {
+    int32_t score = m_evalBatcher ? m_evalBatcher->Evaluate(*acc) : m_nnue->Evaluate(*acc);
+    return std::clamp(score, -s_winScore + 1, s_winScore - 1);
+  }
+
   // A simple memoization technique to avoid recalculating the same board
-  attempted++;
-  const auto& it = s_scoreMap.find(board);
-  if (it != s_scoreMap.end()) {
-    found++;
-    return it->second;
+  t_searchStats.cacheProbes++;
+  if (m_sharedScores) {
+    const uint64_t key = board.GetKey();
+    if (std::optional<int32_t> shared = m_sharedScores->Probe(key)) {
+      t_searchStats.cacheHits++;
+      return *shared;
+    }
+    std::optional<Score> saved = ProbeSavedScores(key);
+    Score score = saved ? *saved : CalcStaticAnalysis(board, m_weights);
+    m_sharedScores->Store(key, score);
+    return score;
   }
 
-  Score score = CalcStaticAnalysis(board);
-  s_scoreMap[board] = score;
+  const auto& it = m_scoreMap.find(board);
+  if (it != m_scoreMap.end()) {
+    t_searchStats.cacheHits++;
+    return it->second;
+  }
+  // the key is only needed for the saved scores
+  std::optional<Score> saved = m_savedScores ? ProbeSavedScores(board.GetKey()) : std::nullopt;
+  Score score = saved ? *saved : CalcStaticAnalysis(board, m_weights);
+  m_scoreMap[board] = score;
   return score;
 }
 
-Score AIPlayer::CalcStaticAnalysis(const Board& board) {
-  // TODO: this function should return the score of the board
+std::optional<Score> AIPlayer::ProbeSavedScores(uint64_t key) {
+  if (!m_savedScores)
+    return std::nullopt;
+  std::optional<int32_t> saved = m_savedScores->Probe(key);
+  if (saved)
+    t_searchStats.cacheHits++;
+  return saved;
+}
+
+void* AIPlayer::ScoreMapResource::do_allocate(std::size_t bytes, std::size_t alignment) {
+  t_searchStats.scoreMapAllocations++;
+  return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void AIPlayer::ScoreMapResource::do_deallocate(void* p, std::size_t bytes, std::size_t alignment) {
+  std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+}
+
+Score AIPlayer::CalcStaticAnalysis(const Board& board, const EvalWeights& weights) {
+  // this function returns the score of the board
   // from the perspective of player X. Meaning that the higher
   // the score, the better it is for player X
 
   if (board.GetTopGameStatus() == GameStatus::XWins) {
-    return 100;
+    return s_winScore;
   } else if (board.GetTopGameStatus() == GameStatus::OWins) {
-    return -100;
+    return -s_winScore;
   } else if (board.GetTopGameStatus() == GameStatus::Draw) {
     return 0;
   }
 
-  return 0;
+  return std::clamp(Evaluate(board, weights), -s_winScore + 1, s_winScore - 1);
 }
@@ -1,11 +1,131 @@
 #pragma once
+#include "EvalBatcher.h"
+#include "Evaluation.h"
+#include "Nnue.h"
+#include "OpeningBook.h"
 #include "Player.h"
+#include "ScoreCache.h"
+#include "SharedScoreCache.h"
+#include "SearchStats.h"
+#include "TimeManager.h"
 
 typedef int32_t Score;
 
+// score of a won game, every other score is strictly smaller
+constexpr Score s_winScore = 10000;
+// bound of the search windows, can be negated safely
+constexpr Score s_infinity = s_winScore + 1;
+
+/**
+ * Tunable parameters of the engine, so different
+ * configurations can be played against each other
+ */
+struct AIConfig {
+  uint8_t depth = 3;
+  // principal variation search: null windows for every move but the first
+  bool pvs = true;
+  // half width of the root window around the previous iteration's score, 0 disables it
+  Score aspirationWindow = 50;
+  // late move reductions: quiet moves tried after the first lmrFullMoves ones
+  // are searched lmrReduction plies shallower when at least lmrMinDepth plies remain.
+  // An even reduction keeps the same player moving last, which the evaluation favors
+  bool lmr = true;
+  int lmrMinDepth = 3;
+  int lmrFullMoves = 3;
+  int lmrReduction = 2;
+  // plies added at the horizon to forcing moves: sub board threats and
+  // moves sending the opponent to a finished sub board, 0 disables it
+  int extension = 0;
+  // weights of the hand written evaluation, the defaults are used if empty
+  std::string weightsPath;
+  // weights of the learned evaluation, the hand written one is used if empty
+  std::string nnuePath;
+  // book of opening moves played without searching, none if empty
+  std::string bookPath;
+  // scores of the hand written evaluation kept between sessions, none if empty.
+  // The file is mapped on startup and rewritten by AIPlayer::SaveScoreCaches
+  std::string cachePath;
+  // most positions written to the cache file
+  std::size_t cacheMaxEntries = 1 << 22;
+  // entries of a score cache shared by every player of the process with the
+  // same evaluation and size, instead of one per player, 0 disables it.
+  // Its scores are not written to the cache file
+  std::size_t sharedCacheEntries = 0;
+  // with a network, evaluates the leaves of the players of the process using the same
+  // network and settings in batches of this size (see EvalBatcher), 1 disables it
+  std::size_t evalBatch = 1;
+  // longest a leaf waits for its batch to fill up
+  std::chrono::microseconds evalBatchLatency{200};
+  // best moves searched exactly and logged by GetMove, to review the game
+  int multiPv = 1;
+
+  /**
+   * Parses a comma separated list of key=value pairs, e.g. "depth=4".
+   * Keys that are not given keep their default value.
+   *
+   * @throws std::invalid_argument on unknown keys or invalid values
+   */
+  static AIConfig Parse(const std::string& str);
+};
+
+std::ostream& operator<<(std::ostream& os, const AIConfig& config);
+template <>
+struct fmt::formatter<AIConfig> : fmt::ostream_formatter {};
+
+/**
+ * Bounds of a single search on top of the configuration. The search
+ * stops at the first one reached, but always completes its first
+ * iteration so it has a move to return.
+ */
+struct SearchLimits {
+  // deepest iteration, as AIConfig::depth, the configured depth if negative
+  int depth = -1;
+  // no limit if 0
+  std::chrono::milliseconds time{0};
+  uint64_t nodes = 0;
+  // set from another thread to stop the search, e.g. on a user request
+  const std::atomic<bool>* stop = nullptr;
+  // number of best moves with an exact score and line, AIConfig::multiPv if 0
+  int multiPv = 0;
+  // ends the search early once the clock says so, e.g. when the best move is stable
+  TimeManager* timeManager = nullptr;
+};
+
+/**
+ * One of the best moves of a search, with its line
+ */
+struct PvLine {
+  Move move;
+  Score score = 0;
+  std::vector<Move> pv;
+};
+
+/**
+ * Best move found by a search and how it was found
+ */
+struct SearchResult {
+  Move move;
+  // from the point of view of the player to move
+  Score score = 0;
+  // the moves both players are expected to play, starting with move
+  std::vector<Move> pv;
+  SearchStats stats;
+  // the multi-PV best moves, best first, the first one being move itself.
+  // Every line beats the moves that are not listed
+  std::vector<PvLine> lines;
+};
+
 class AIPlayer : public Player {
 public:
   AIPlayer() = default;
+  explicit AIPlayer(const AIConfig& config);
+  /**
+   * @param sharedScores cache shared with other players, e.g. the ones of a
+   * server, used instead of AIConfig::sharedCacheEntries. It must have been
+   * created for the evaluation of config, see GetEvalStamp
+   */
+  AIPlayer(const AIConfig& config, std::shared_ptr<SharedScoreCache> sharedScores);
+  ~AIPlayer() override { FlushScores(); }
   virtual void Initialize(PlayerSymbol player, const Board& board) override {
     SPDLOG_TRACE("Initializing MinMaxPlayer with player: {}", player);
     m_player = player;
@@ -15,23 +135,149 @@ public:
 
   virtual Move GetMove() override;
   virtual void ReceiveMove(const Move& move) override;
-  virtual void Reset() override {}
+  // the next search goes as deep as the budget of its TimeManager allows
+  virtual void SetTimeLeft(std::chrono::milliseconds remaining, std::chrono::milliseconds increment) override {
+    m_timeLeft = {remaining, increment};
+  }
 
-  static float HitRatio() { return ((found * 1.0f) / (attempted * 1.0f)); }
-  static std::pair<int, int> HitStats() { return {attempted, found}; }
+  // called with the best move so far after every completed iteration
+  using IterationCallback = std::function<void(const SearchResult&)>;
+
+  /**
+   * Searches board without playing the move and without using the book,
+   * e.g. to analyse the positions of finished games
+   *
+   * @param onIteration called on the searching thread, may be empty
+   * @return the result, or nullopt if the game is over
+   */
+  std::optional<SearchResult> Analyze(const Board& board, const SearchLimits& limits = {},
+                                      const IterationCallback& onIteration = {});
+  virtual void Reset() override {
+    m_mainBoard = Board();
+    m_isTerminated = false;
+    m_timeLeft = std::nullopt;
+    // positions of the previous game are unlikely to come back,
+    // the shared cache is left to the other players using it
+    FlushScores();
+    m_scoreMap.clear();
+  }
+
+  // statistics of the last search made by this player
+  const SearchStats& GetLastSearchStats() const { return m_lastSearchStats; }
+  // score of the last move played by this player, from its point of view
+  Score GetLastScore() const { return m_lastScore; }
+  // statistics accumulated over every search made in this process
+  static SearchStats GetTotalSearchStats();
+  /**
+   * Score of the hand written evaluation, as the search computes
+   * it when there is no network and the position is not cached
+   *
+   * @return the score from X's point of view, s_winScore if X won
+   */
+  static Score CalcStaticAnalysis(const Board& board, const EvalWeights& weights);
+
+  /**
+   * Writes the scores computed by every player configured with a cache
+   * file, together with those already in the file. Call it once the
+   * players are destroyed or reset, at the end of the session.
+   */
+  static void SaveScoreCaches();
 
 private:
-  Score Negamax(const Board& board, int depth, Score alpha, Score beta, int weigth);
-  Score StaticAnalysis(const Board& board);
-  Score CalcStaticAnalysis(const Board& board);
-  std::vector<std::pair<Move, Board>> GetChildrenBoards(const Board& board);
+  struct RootMove {
+    Move move;
+    Board board;
+    Nnue::Accumulator acc;
+    // score of the last iteration, used to order the moves
+    Score score = -s_infinity;
+    // principal variation of the last iteration that found the move better than the others
+    std::vector<Move> pv;
+  };
+
+  // longest line the search can look at, a game has at most 81 moves
+  static constexpr int s_maxPly = 9 * 9 + 2;
+
+  // searches board, where Us is to move, and sorts rootMoves best first
+  template <PlayerSymbol Us>
+  Score Search(const Board& board, std::vector<RootMove>& rootMoves, const IterationCallback& onIteration);
+  template <PlayerSymbol Us>
+  Score SearchRoot(std::vector<RootMove>& rootMoves, int depth, Score alpha, Score beta);
+  template <PlayerSymbol Us>
+  Score SearchAspiration(std::vector<RootMove>& rootMoves, int depth, Score previous);
+  template <PlayerSymbol Us>
+  Score Negamax(const Board& board, const Nnue::Accumulator* acc, int depth, int ply, Score alpha, Score beta);
+  template <PlayerSymbol Them>
+  Score SearchChild(const Board& child, const Nnue::Accumulator* acc, int depth, int ply, Score alpha, Score beta, bool fullWindow);
+  Score StaticAnalysis(const Board& board, const Nnue::Accumulator* acc);
+  std::optional<Score> ProbeSavedScores(uint64_t key);
+  // stops the search once a limit is reached or the player is terminated
+  void CheckLimits();
+  bool IsStopped() const { return m_isStopped || m_isTerminated; }
+  // the result of the last completed iteration, rootMoves sorted best first
+  SearchResult MakeResult(const std::vector<RootMove>& rootMoves, Score bestValue) const;
+  // makes move followed by the principal variation of the child the one of ply
+  void UpdatePv(int ply, const Move& move);
+  // replaces the content of boards, reusing its capacity
+  template <PlayerSymbol Us>
+  void GetChildrenBoards(const Board& board, std::vector<std::pair<Move, Board>>& boards);
+  // hands the scores of m_scoreMap over to SaveScoreCaches
+  void FlushScores();
   PlayerSymbol m_player;
   Board m_mainBoard;
-  uint8_t m_depth = 3;
+  AIConfig m_config;
+  EvalWeights m_weights;
+  // optional learned evaluation, shared between players using the same file
+  std::shared_ptr<const Nnue> m_nnue;
+  // evaluates m_nnue with the leaves of other players if set
+  std::shared_ptr<EvalBatcher> m_evalBatcher;
+  std::shared_ptr<const OpeningBook> m_book;
+  // scores saved by previous sessions with the same evaluation
+  std::shared_ptr<const ScoreCache> m_savedScores;
   std::atomic<bool> m_isTerminated = false;
+  // limits of the current search
+  SearchLimits m_limits;
+  int m_maxDepth = 0;
+  int m_multiPv = 1;
+  std::chrono::steady_clock::time_point m_searchStart;
+  bool m_isStopped = false;
+  // principal variation of each ply, m_pvTable[ply][ply, m_pvLength[ply])
+  std::array<std::array<Move, s_maxPly>, s_maxPly> m_pvTable;
+  std::array<int, s_maxPly> m_pvLength;
+  // children of the node searched at each ply, kept so that
+  // the search stops allocating once every ply was reached
+  std::array<std::vector<std::pair<Move, Board>>, s_maxPly> m_children;
+  SearchStats m_lastSearchStats;
+  Score m_lastScore = 0;
+  // clock of the next move, remaining and increment, if the game has one
+  std::optional<std::pair<std::chrono::milliseconds, std::chrono::milliseconds>> m_timeLeft;
+
+  // where the pool of the score map gets its memory, counting it in SearchStats::scoreMapAllocations
+  class ScoreMapResource : public std::pmr::memory_resource {
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+  };
+
+  // the scores depend on the weights, so every player has its own cache.
+  // Its nodes come from the pool, which keeps them when the map is cleared,
+  // instead of one heap allocation per new position
+  ScoreMapResource m_scoreUpstream;
+  std::pmr::unsynchronized_pool_resource m_scorePool{&m_scoreUpstream};
+  std::pmr::unordered_map<Board, Score> m_scoreMap{&m_scorePool};
+  // replaces m_scoreMap if set
+  std::shared_ptr<SharedScoreCache> m_sharedScores;
+
+  // static variables for bookkeeping
+  static std::mutex s_totalStatsMutex;
+  static SearchStats s_totalStats;
 
-  // static variables for caching and bookkeeping
-  static std::unordered_map<Board, Score> s_scoreMap;
-  static int attempted;
-  static int found;
+  // scores to save, by cache file
+  struct PendingScores {
+    uint64_t evalStamp;
+    std::size_t maxEntries;
+    // ordered to keep the smallest keys
+    std::map<uint64_t, Score> scores;
+  };
+  static std::mutex s_pendingScoresMutex;
+  static std::map<std::string, PendingScores> s_pendingScores;
 };
\ No newline at end of file
@@ -0,0 +1,69 @@
+#include "pch.h"
+#include "EvalBatcher.h"
+
+EvalBatcher::EvalBatcher(std::shared_ptr<const Nnue> nnue, std::size_t batchSize, std::chrono::microseconds maxLatency)
+    : m_nnue(std::move(nnue)), m_batchSize(std::max<std::size_t>(batchSize, 1)), m_maxLatency(maxLatency) {
+  m_pending.reserve(m_batchSize);
+}
+
+int32_t EvalBatcher::Evaluate(const Nnue::Accumulator& acc) {
+  if (m_batchSize == 1) {
+    m_batches.fetch_add(1, std::memory_order_relaxed);
+    m_evaluations.fetch_add(1, std::memory_order_relaxed);
+    return m_nnue->Evaluate(acc);
+  }
+
+  Request request{&acc};
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_pending.push_back(&request);
+  if (m_pending.size() >= m_batchSize) {
+    Flush(lock);
+    return request.score;
+  }
+  if (!m_batchDone.wait_for(lock, m_maxLatency, [&request] { return request.isDone; })) {
+    if (request.isTaken) {
+      // another thread is evaluating it, which cannot take long
+      m_batchDone.wait(lock, [&request] { return request.isDone; });
+    } else {
+      // waited long enough, the searches that joined since come along
+      m_partialBatches.fetch_add(1, std::memory_order_relaxed);
+      Flush(lock);
+    }
+  }
+  return request.score;
+}
+
+void EvalBatcher::Flush(std::unique_lock<std::mutex>& lock) {
+  std::vector<Request*> batch;
+  if (!m_spareBatches.empty()) {
+    batch = std::move(m_spareBatches.back());
+    m_spareBatches.pop_back();
+  } else {
+    batch.reserve(m_batchSize);
+  }
+  std::swap(batch, m_pending);
+  for (Request* request : batch)
+    request->isTaken = true;
+  lock.unlock();
+
+  // the searches of the batch are all waiting, so their accumulators stay put
+  std::array<const Nnue::Accumulator*, 256> accs;
+  std::array<int32_t, 256> scores;
+  for (std::size_t start = 0; start < batch.size(); start += accs.size()) {
+    const std::size_t size = std::min(accs.size(), batch.size() - start);
+    for (std::size_t i = 0; i < size; i++)
+      accs[i] = batch[start + i]->acc;
+    m_nnue->EvaluateBatch(accs.data(), size, scores.data());
+    for (std::size_t i = 0; i < size; i++)
+      batch[start + i]->score = scores[i];
+  }
+  m_batches.fetch_add(1, std::memory_order_relaxed);
+  m_evaluations.fetch_add(batch.size(), std::memory_order_relaxed);
+
+  lock.lock();
+  for (Request* request : batch)
+    request->isDone = true;
+  batch.clear();
+  m_spareBatches.push_back(std::move(batch));
+  m_batchDone.notify_all();
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "Nnue.h"
+
+/**
+ * Evaluates the leaves of searches running on different threads in
+ * batches, with Nnue::EvaluateBatch. A search asking for a score waits
+ * until its batch is full, and the thread completing a batch evaluates
+ * it for everyone, so there is no evaluation thread to hand over to.
+ * A batch that does not fill up is evaluated by its oldest waiter once
+ * the latency cap has passed.
+ *
+ * Only worth it with several searches at once: a lone search waits for
+ * the latency cap on every leaf.
+ */
+class EvalBatcher {
+public:
+  /**
+   * @param batchSize positions evaluated together, 1 evaluates right away
+   * @param maxLatency longest a search waits for its batch to fill up
+   */
+  EvalBatcher(std::shared_ptr<const Nnue> nnue, std::size_t batchSize, std::chrono::microseconds maxLatency);
+
+  EvalBatcher(const EvalBatcher&) = delete;
+  EvalBatcher& operator=(const EvalBatcher&) = delete;
+
+  // same as Nnue::Evaluate, blocks until the batch of acc is evaluated
+  int32_t Evaluate(const Nnue::Accumulator& acc);
+
+  std::size_t GetBatchSize() const { return m_batchSize; }
+  // number of batches evaluated, and how many were flushed before they were full
+  uint64_t GetBatchCount() const { return m_batches; }
+  uint64_t GetPartialBatchCount() const { return m_partialBatches; }
+  uint64_t GetEvaluationCount() const { return m_evaluations; }
+
+private:
+  // lives on the stack of the waiting search
+  struct Request {
+    const Nnue::Accumulator* acc;
+    int32_t score = 0;
+    // taken out of m_pending by a flush, which may still be evaluating it
+    bool isTaken = false;
+    bool isDone = false;
+  };
+
+  // evaluates the pending requests without holding the lock, lock is held again on return
+  void Flush(std::unique_lock<std::mutex>& lock);
+
+  std::shared_ptr<const Nnue> m_nnue;
+  std::size_t m_batchSize;
+  std::chrono::microseconds m_maxLatency;
+
+  std::mutex m_mutex;
+  std::condition_variable m_batchDone;
+  std::vector<Request*> m_pending;
+  // buffers of the batches evaluated so far, one is swapped with m_pending by each
+  // flush. There are as many as flushes that ran at the same time, usually one
+  std::vector<std::vector<Request*>> m_spareBatches;
+  std::atomic<uint64_t> m_batches = 0;
+  std::atomic<uint64_t> m_partialBatches = 0;
+  std::atomic<uint64_t> m_evaluations = 0;
+};
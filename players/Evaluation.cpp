@@ -0,0 +1,140 @@
+#include "pch.h"
+#include "Evaluation.h"
+#include "SmallBoard.h"
+
+static constexpr std::array<const char*, s_evalTermCount> s_termNames = {
+    "board_won_center",
+    "board_won_corner",
+    "board_won_edge",
+    "cell_center",
+    "cell_corner",
+    "cell_edge",
+    "small_threat",
+    "big_threat",
+    "side_to_move",
+    "free_move",
+};
+
+static constexpr std::array<std::array<int, 3>, 8> s_lines = {{
+    {{0, 1, 2}},
+    {{3, 4, 5}},
+    {{6, 7, 8}},
+    {{0, 3, 6}},
+    {{1, 4, 7}},
+    {{2, 5, 8}},
+    {{0, 4, 8}},
+    {{2, 4, 6}},
+}};
+
+// version of the features and of how they are combined, see GetEvalStamp
+static constexpr uint64_t s_evalVersion = 1;
+
+const char* GetEvalTermName(EvalTerm term) { return s_termNames[static_cast<int>(term)]; }
+
+uint64_t GetEvalStamp(const EvalWeights& weights) {
+  // FNV-1a over the version and the weights
+  uint64_t stamp = 0xcbf29ce484222325ull;
+  auto mix = [&](uint64_t value) { stamp = (stamp ^ value) * 0x100000001b3ull; };
+  mix(s_evalVersion);
+  mix(s_evalTermCount);
+  for (int32_t value : weights.values)
+    mix(static_cast<uint32_t>(value));
+  return stamp;
+}
+
+std::optional<EvalWeights> EvalWeights::Load(const std::string& path) {
+  std::ifstream is(path);
+  if (!is) {
+    SPDLOG_ERROR("Could not open weights file {}", path);
+    return std::nullopt;
+  }
+
+  EvalWeights weights;
+  std::string line;
+  while (std::getline(is, line)) {
+    std::istringstream ss(line);
+    std::string name;
+    int32_t value;
+    if (!(ss >> name) || name[0] == '#')
+      continue;
+    if (!(ss >> value)) {
+      SPDLOG_ERROR("Missing value for {} in {}", name, path);
+      return std::nullopt;
+    }
+
+    auto it = std::find_if(s_termNames.begin(), s_termNames.end(), [&](const char* termName) {
+      return name == termName;
+    });
+    if (it == s_termNames.end()) {
+      SPDLOG_WARN("Ignoring unknown evaluation term {} in {}", name, path);
+      continue;
+    }
+    weights.values[it - s_termNames.begin()] = value;
+  }
+  return weights;
+}
+
+bool EvalWeights::Save(const std::string& path) const {
+  std::ofstream os(path);
+  os << "# evaluation weights, a won game is worth 10000\n";
+  for (int term = 0; term < s_evalTermCount; term++)
+    os << s_termNames[term] << " " << values[term] << "\n";
+  return static_cast<bool>(os);
+}
+
+// +1 for X, -1 for O, 0 for nobody
+static int Sign(Piece piece) { return static_cast<int>(piece); }
+static int Sign(GameStatus status) {
+  return status == GameStatus::XWins ? 1 : status == GameStatus::OWins ? -1
+                                                                       : 0;
+}
+
+EvalFeatures ExtractFeatures(const Board& board) {
+  std::array<int, s_evalTermCount> counts = {0};
+  auto count = [&](EvalTerm term) -> int& { return counts[static_cast<int>(term)]; };
+
+  const std::array<GameStatus, 9> bigBoard = board.GetBigBoard();
+  for (int boardPosition = 0; boardPosition < 9; boardPosition++) {
+    GameStatus status = bigBoard[boardPosition];
+    if (status != GameStatus::InProgress) {
+      EvalTerm term = boardPosition == 4 ? EvalTerm::BoardWonCenter : boardPosition % 2 == 0 ? EvalTerm::BoardWonCorner
+                                                                                             : EvalTerm::BoardWonEdge;
+      count(term) += Sign(status);
+      continue;
+    }
+
+    for (int cell = 0; cell < 9; cell++) {
+      EvalTerm term = cell == 4 ? EvalTerm::CellCenter : cell % 2 == 0 ? EvalTerm::CellCorner
+                                                                       : EvalTerm::CellEdge;
+      count(term) += Sign(board.GetPieceAt(boardPosition, cell));
+    }
+    const SmallBoardInfo& info = GetSmallBoardInfo(board, boardPosition);
+    count(EvalTerm::SmallThreat) += info.threats[0] - info.threats[1];
+  }
+
+  for (const auto& [a, b, c] : s_lines) {
+    int sum = Sign(bigBoard[a]) + Sign(bigBoard[b]) + Sign(bigBoard[c]);
+    bool open = bigBoard[a] == GameStatus::InProgress ||
+                bigBoard[b] == GameStatus::InProgress ||
+                bigBoard[c] == GameStatus::InProgress;
+    if ((sum == 2 || sum == -2) && open)
+      count(EvalTerm::BigThreat) += sum / 2;
+  }
+
+  int toMove = board.GetCurrentPlayer() == PlayerSymbol::X ? 1 : -1;
+  count(EvalTerm::SideToMove) = toMove;
+  if (board.GetLastMove() && board.GetForcedBoard() < 0)
+    count(EvalTerm::FreeMove) = toMove;
+
+  EvalFeatures features;
+  for (int term = 0; term < s_evalTermCount; term++)
+    features[term] = static_cast<int8_t>(counts[term]);
+  return features;
+}
+
+int32_t Evaluate(const EvalFeatures& features, const EvalWeights& weights) {
+  int32_t score = 0;
+  for (int term = 0; term < s_evalTermCount; term++)
+    score += features[term] * weights.values[term];
+  return score;
+}
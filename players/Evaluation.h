@@ -0,0 +1,69 @@
+#pragma once
+#include "../Board.h"
+
+/**
+ * Terms of the hand written evaluation. The evaluation is linear:
+ * each term counts something for X minus the same thing for O and
+ * is multiplied by its weight.
+ */
+enum class EvalTerm {
+  // finished sub boards won, depending on where they are on the big board
+  BoardWonCenter,
+  BoardWonCorner,
+  BoardWonEdge,
+  // pieces in sub boards still in progress, depending on the cell
+  CellCenter,
+  CellCorner,
+  CellEdge,
+  // lines of a sub board in progress with two pieces and an empty cell
+  SmallThreat,
+  // lines of the big board with two won boards and one still in progress
+  BigThreat,
+  // +1 when X is to move
+  SideToMove,
+  // +1 when X is to move and can play in any board
+  FreeMove,
+  Count
+};
+
+constexpr int s_evalTermCount = static_cast<int>(EvalTerm::Count);
+
+// what each term amounts to in a given position
+typedef std::array<int8_t, s_evalTermCount> EvalFeatures;
+
+struct EvalWeights {
+  std::array<int32_t, s_evalTermCount> values = {100, 80, 60, 6, 4, 2, 15, 150, 10, 30};
+
+  int32_t& operator[](EvalTerm term) { return values[static_cast<int>(term)]; }
+  int32_t operator[](EvalTerm term) const { return values[static_cast<int>(term)]; }
+
+  /**
+   * Loads weights from a text file with one "name value" pair per line,
+   * lines starting with # are ignored. Terms not in the file keep their
+   * default weight.
+   *
+   * @return the weights, or std::nullopt if the file cannot be read
+   */
+  static std::optional<EvalWeights> Load(const std::string& path);
+  bool Save(const std::string& path) const;
+};
+
+const char* GetEvalTermName(EvalTerm term);
+
+/**
+ * Identifies the scores an evaluation produces: the same stamp means the
+ * same scores. Covers the weights and s_evalVersion, which must be bumped
+ * whenever ExtractFeatures or Evaluate change.
+ */
+uint64_t GetEvalStamp(const EvalWeights& weights);
+
+EvalFeatures ExtractFeatures(const Board& board);
+
+/**
+ * Scores a position that is still in progress from X's point of view,
+ * the caller is responsible for the finished ones
+ */
+int32_t Evaluate(const EvalFeatures& features, const EvalWeights& weights);
+inline int32_t Evaluate(const Board& board, const EvalWeights& weights) {
+  return Evaluate(ExtractFeatures(board), weights);
+}
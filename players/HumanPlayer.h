@@ -1,4 +1,5 @@
 #pragma once
+#include "../GameScheduler.h"
 #include "Player.h"
 
 class HumanPlayer : public Player {
@@ -10,18 +11,29 @@ public:
   virtual void Terminate() override {
     m_isTerminated = true;
     m_cv.notify_all();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    ResumeWaiting();
+  }
+
+  virtual void SetTimeLeft(std::chrono::milliseconds remaining, std::chrono::milliseconds) override {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_deadline = std::chrono::steady_clock::now() + remaining;
   }
 
   virtual Move GetMove() override {
-    // wait until a move is chosen
+    // wait until a move is chosen, or the clock runs out
     std::unique_lock<std::mutex> lock(m_mutex);
-    m_cv.wait(lock, [this] {
+    auto isReady = [this] {
       return m_chosenMove.has_value() || m_isTerminated;
-    });
+    };
+    if (m_deadline)
+      m_cv.wait_until(lock, *std::exchange(m_deadline, std::nullopt), isReady);
+    else
+      m_cv.wait(lock, isReady);
 
     if (!m_chosenMove) {
       // this can occur if we want to close the
-      // game while the player is thinking
+      // game while the player is thinking, or on time
       // since we have to return something to get
       // back to the game loop we arbitrarily
       // return 0,0 and the game loop will check
@@ -32,8 +44,17 @@ public:
     return std::exchange(m_chosenMove, std::nullopt).value();
   }
 
+  virtual Task<Move> GetMoveAsync(GameScheduler& scheduler) override {
+    co_return co_await MoveAwaiter{*this, scheduler};
+  }
+
   virtual void ReceiveMove(const Move&) override {}
-  virtual void Reset() override {}
+  virtual void Reset() override {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_chosenMove = std::nullopt;
+    m_deadline = std::nullopt;
+    m_isTerminated = false;
+  }
 
   virtual void OnMouseButtonEvent(double x, double y) override {
     int row = static_cast<int>(y * 9);
@@ -43,13 +64,62 @@ public:
     std::unique_lock<std::mutex> lock(m_mutex);
     m_chosenMove = move;
     m_cv.notify_all();
+    ResumeWaiting();
   }
 
 private:
+  // a game suspended in GetMoveAsync until the click
+  struct Waiting {
+    GameScheduler& scheduler;
+    std::coroutine_handle<> handle;
+    // resumes the game without a move when the clock runs out
+    std::optional<uint64_t> timer;
+  };
+
+  struct MoveAwaiter {
+    HumanPlayer& player;
+    GameScheduler& scheduler;
+
+    bool await_ready() const noexcept { return false; }
+    // the lock makes sure a click between the check and the suspension is not lost,
+    // and that a click and the timer of the clock cannot both resume the game
+    bool await_suspend(std::coroutine_handle<> handle) {
+      std::unique_lock<std::mutex> lock(player.m_mutex);
+      std::optional<std::chrono::steady_clock::time_point> deadline = std::exchange(player.m_deadline, std::nullopt);
+      if (player.m_chosenMove || player.m_isTerminated)
+        return false;
+      Waiting& waiting = player.m_waiting.emplace(scheduler, handle);
+      if (deadline)
+        waiting.timer = scheduler.PostAt(*deadline, handle);
+      return true;
+    }
+    // same as GetMove, 0,0 if the game was closed or the clock ran out
+    Move await_resume() {
+      std::unique_lock<std::mutex> lock(player.m_mutex);
+      // still set if the timer resumed the game
+      player.m_waiting = std::nullopt;
+      return std::exchange(player.m_chosenMove, std::nullopt).value_or(Move(0, 0));
+    }
+  };
+
+  // with m_mutex held
+  void ResumeWaiting() {
+    if (!m_waiting)
+      return;
+    Waiting waiting = *std::exchange(m_waiting, std::nullopt);
+    // a timer that fired already resumes the game itself, which then
+    // takes the move if there is one by then
+    if (!waiting.timer || waiting.scheduler.CancelTimer(*waiting.timer))
+      waiting.scheduler.Post(waiting.handle);
+  }
+
   PlayerSymbol m_player;
   std::optional<Move> m_chosenMove = std::nullopt;
+  // when the clock of the move runs out, if the game has one
+  std::optional<std::chrono::steady_clock::time_point> m_deadline;
 
   std::mutex m_mutex;
   std::condition_variable m_cv;
+  std::optional<Waiting> m_waiting;
   std::atomic<bool> m_isTerminated = false;
 };
\ No newline at end of file
@@ -0,0 +1,265 @@
+#include "pch.h"
+#include "Nnue.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// file layout, all values little endian:
+//   char[8]  magic "ETTTNNUE"
+//   uint32   version
+//   uint32   inputs, l1, l2
+//   int16    feature weights [inputs][l1]
+//   int16    feature bias [l1]
+//   int8     l2 weights [l2][l1]
+//   int32    l2 bias [l2]
+//   int8     output weights [l2]
+//   int32    output bias
+static constexpr char s_magic[8] = {'E', 'T', 'T', 'T', 'N', 'N', 'U', 'E'};
+static constexpr uint32_t s_version = 1;
+
+// converts between the host and the file byte order, both ways
+template <typename T>
+static T SwapToLittleEndian(T value) {
+  if constexpr (std::endian::native == std::endian::little || sizeof(T) == 1) {
+    return value;
+  } else {
+    auto bytes = std::bit_cast<std::array<uint8_t, sizeof(T)>>(value);
+    std::reverse(bytes.begin(), bytes.end());
+    return std::bit_cast<T>(bytes);
+  }
+}
+
+template <typename T>
+static bool ReadValues(std::istream& is, T* values, std::size_t count) {
+  is.read(reinterpret_cast<char*>(values), static_cast<std::streamsize>(count * sizeof(T)));
+  if constexpr (std::endian::native != std::endian::little) {
+    for (std::size_t i = 0; i < count; i++)
+      values[i] = SwapToLittleEndian(values[i]);
+  }
+  return static_cast<bool>(is);
+}
+
+template <typename T>
+static void WriteValues(std::ostream& os, const T* values, std::size_t count) {
+  if constexpr (std::endian::native != std::endian::little) {
+    for (std::size_t i = 0; i < count; i++) {
+      T value = SwapToLittleEndian(values[i]);
+      os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+    return;
+  }
+  os.write(reinterpret_cast<const char*>(values), static_cast<std::streamsize>(count * sizeof(T)));
+}
+
+std::shared_ptr<const Nnue> Nnue::Load(const std::string& path) {
+  std::ifstream is(path, std::ios::binary);
+  if (!is) {
+    SPDLOG_ERROR("Could not open network file {}", path);
+    return nullptr;
+  }
+
+  char magic[8];
+  uint32_t header[4];
+  if (!ReadValues(is, magic, 8) || !std::equal(magic, magic + 8, s_magic) ||
+      !ReadValues(is, header, 4)) {
+    SPDLOG_ERROR("{} is not a network file", path);
+    return nullptr;
+  }
+  if (header[0] != s_version || header[1] != s_inputs || header[2] != s_l1 || header[3] != s_l2) {
+    SPDLOG_ERROR("{} has version {} and shape {}x{}x{}, expected version {} and shape {}x{}x{}",
+                 path, header[0], header[1], header[2], header[3], s_version, s_inputs, s_l1, s_l2);
+    return nullptr;
+  }
+
+  std::shared_ptr<Nnue> nnue(new Nnue());
+  bool ok = ReadValues(is, nnue->m_featureWeights.data(), nnue->m_featureWeights.size()) &&
+            ReadValues(is, nnue->m_featureBias.data(), nnue->m_featureBias.size()) &&
+            ReadValues(is, nnue->m_l2Weights.data(), nnue->m_l2Weights.size()) &&
+            ReadValues(is, nnue->m_l2Bias.data(), nnue->m_l2Bias.size()) &&
+            ReadValues(is, nnue->m_outputWeights.data(), nnue->m_outputWeights.size()) &&
+            ReadValues(is, &nnue->m_outputBias, 1);
+  if (!ok) {
+    SPDLOG_ERROR("{} is truncated", path);
+    return nullptr;
+  }
+
+  SPDLOG_INFO("Loaded network {}", path);
+  return nnue;
+}
+
+bool Nnue::Save(const std::string& path) const {
+  std::ofstream os(path, std::ios::binary);
+  const uint32_t header[4] = {s_version, s_inputs, s_l1, s_l2};
+  WriteValues(os, s_magic, 8);
+  WriteValues(os, header, 4);
+  WriteValues(os, m_featureWeights.data(), m_featureWeights.size());
+  WriteValues(os, m_featureBias.data(), m_featureBias.size());
+  WriteValues(os, m_l2Weights.data(), m_l2Weights.size());
+  WriteValues(os, m_l2Bias.data(), m_l2Bias.size());
+  WriteValues(os, m_outputWeights.data(), m_outputWeights.size());
+  WriteValues(os, &m_outputBias, 1);
+  return static_cast<bool>(os);
+}
+
+std::shared_ptr<Nnue> Nnue::Random(uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> small(-16, 16);
+  std::shared_ptr<Nnue> nnue(new Nnue());
+  for (int16_t& w : nnue->m_featureWeights)
+    w = static_cast<int16_t>(small(rng));
+  for (int16_t& b : nnue->m_featureBias)
+    b = static_cast<int16_t>(small(rng) + 32);
+  for (int8_t& w : nnue->m_l2Weights)
+    w = static_cast<int8_t>(small(rng));
+  for (int8_t& w : nnue->m_outputWeights)
+    w = static_cast<int8_t>(small(rng));
+  return nnue;
+}
+
+int Nnue::BigBoardFeature(int boardPosition, GameStatus status) {
+  int offset = status == GameStatus::XWins ? 0 : status == GameStatus::OWins ? 1
+                                                                             : 2;
+  return 81 * 2 + boardPosition * 3 + offset;
+}
+
+void Nnue::Refresh(const Board& board, Accumulator& acc) const {
+  std::array<int, 81 + 9 + 2> features;
+  std::size_t count = 0;
+
+  for (int idx = 0; idx < 9 * 9; idx++) {
+    Piece piece = board.GetPieceAt(idx / 9, idx % 9);
+    if (piece != Piece::Empty)
+      features[count++] = CellFeature(piece, idx);
+  }
+  const std::array<GameStatus, 9> bigBoard = board.GetBigBoard();
+  for (int boardPosition = 0; boardPosition < 9; boardPosition++) {
+    if (bigBoard[boardPosition] != GameStatus::InProgress)
+      features[count++] = BigBoardFeature(boardPosition, bigBoard[boardPosition]);
+  }
+  features[count++] = ForcedBoardFeature(board.GetForcedBoard());
+  if (board.GetCurrentPlayer() == PlayerSymbol::O)
+    features[count++] = s_oToMoveFeature;
+
+  acc.values = m_featureBias;
+  for (std::size_t f = 0; f < count; f++) {
+    const int16_t* row = &m_featureWeights[features[f] * s_l1];
+    for (int i = 0; i < s_l1; i++)
+      acc.values[i] = static_cast<int16_t>(acc.values[i] + row[i]);
+  }
+}
+
+void Nnue::Update(const Board& parent,
+                  const Move& move,
+                  const Board& child,
+                  const Accumulator& parentAcc,
+                  Accumulator& childAcc) const {
+  // a move changes at most: the cell played, the status of its board,
+  // the forced board and the side to move
+  std::array<int, 4> added;
+  std::array<int, 2> removed;
+  std::size_t addedCount = 0;
+  std::size_t removedCount = 0;
+
+  added[addedCount++] = CellFeature(parent.GetCurrentPlayer() == PlayerSymbol::X ? Piece::X : Piece::O,
+                                    move.m_boardPosition * 9 + move.m_cellPosition);
+
+  GameStatus status = child.GetBigBoard()[move.m_boardPosition];
+  if (status != GameStatus::InProgress)
+    added[addedCount++] = BigBoardFeature(move.m_boardPosition, status);
+
+  int parentForced = ForcedBoardFeature(parent.GetForcedBoard());
+  int childForced = ForcedBoardFeature(child.GetForcedBoard());
+  if (parentForced != childForced) {
+    removed[removedCount++] = parentForced;
+    added[addedCount++] = childForced;
+  }
+
+  if (child.GetCurrentPlayer() == PlayerSymbol::O)
+    added[addedCount++] = s_oToMoveFeature;
+  else
+    removed[removedCount++] = s_oToMoveFeature;
+
+  childAcc.values = parentAcc.values;
+  for (std::size_t f = 0; f < addedCount; f++) {
+    const int16_t* row = &m_featureWeights[added[f] * s_l1];
+    for (int i = 0; i < s_l1; i++)
+      childAcc.values[i] = static_cast<int16_t>(childAcc.values[i] + row[i]);
+  }
+  for (std::size_t f = 0; f < removedCount; f++) {
+    const int16_t* row = &m_featureWeights[removed[f] * s_l1];
+    for (int i = 0; i < s_l1; i++)
+      childAcc.values[i] = static_cast<int16_t>(childAcc.values[i] - row[i]);
+  }
+}
+
+/**
+ * Dot product of clipped activations with int8 weights,
+ * size must be a multiple of 32
+ */
+static int32_t DotProduct(const uint8_t* input, const int8_t* weights, int size) {
+#if defined(__AVX2__)
+  const __m256i ones = _mm256_set1_epi16(1);
+  __m256i sum = _mm256_setzero_si256();
+  for (int i = 0; i < size; i += 32) {
+    __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+    __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + i));
+    // activations are at most 127 so the pairwise int16 sums cannot saturate
+    __m256i products = _mm256_maddubs_epi16(in, w);
+    sum = _mm256_add_epi32(sum, _mm256_madd_epi16(products, ones));
+  }
+  __m128i sum128 = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+  sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0x4E));
+  sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0xB1));
+  return _mm_cvtsi128_si32(sum128);
+#else
+  // simple enough for the compiler to vectorize
+  int32_t sum = 0;
+  for (int i = 0; i < size; i++)
+    sum += static_cast<int32_t>(input[i]) * weights[i];
+  return sum;
+#endif
+}
+
+int32_t Nnue::Evaluate(const Accumulator& acc) const {
+  alignas(32) std::array<uint8_t, s_l1> input;
+  for (int i = 0; i < s_l1; i++)
+    input[i] = static_cast<uint8_t>(std::clamp<int16_t>(acc.values[i], 0, 127));
+
+  alignas(32) std::array<uint8_t, s_l2> hidden;
+  for (int o = 0; o < s_l2; o++) {
+    int32_t sum = m_l2Bias[o] + DotProduct(input.data(), &m_l2Weights[o * s_l1], s_l1);
+    hidden[o] = static_cast<uint8_t>(std::clamp(sum >> s_l2Shift, 0, 127));
+  }
+
+  int32_t output = m_outputBias + DotProduct(hidden.data(), m_outputWeights.data(), s_l2);
+  return output / s_outputDivisor;
+}
+
+void Nnue::EvaluateBatch(const Accumulator* const* accs, std::size_t count, int32_t* scores) const {
+  // positions handled together, their activations stay in L1
+  constexpr std::size_t s_chunk = 64;
+  alignas(32) std::array<std::array<uint8_t, s_l1>, s_chunk> input;
+  alignas(32) std::array<std::array<uint8_t, s_l2>, s_chunk> hidden;
+
+  for (std::size_t start = 0; start < count; start += s_chunk) {
+    const std::size_t size = std::min(s_chunk, count - start);
+    for (std::size_t b = 0; b < size; b++) {
+      for (int i = 0; i < s_l1; i++)
+        input[b][i] = static_cast<uint8_t>(std::clamp<int16_t>(accs[start + b]->values[i], 0, 127));
+    }
+
+    for (int o = 0; o < s_l2; o++) {
+      const int8_t* row = &m_l2Weights[o * s_l1];
+      for (std::size_t b = 0; b < size; b++) {
+        int32_t sum = m_l2Bias[o] + DotProduct(input[b].data(), row, s_l1);
+        hidden[b][o] = static_cast<uint8_t>(std::clamp(sum >> s_l2Shift, 0, 127));
+      }
+    }
+
+    for (std::size_t b = 0; b < size; b++) {
+      int32_t output = m_outputBias + DotProduct(hidden[b].data(), m_outputWeights.data(), s_l2);
+      scores[start + b] = output / s_outputDivisor;
+    }
+  }
+}
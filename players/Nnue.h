@@ -0,0 +1,91 @@
+#pragma once
+#include "../Board.h"
+
+/**
+ * Small efficiently updatable neural network used as an optional
+ * evaluation by the AIPlayer.
+ *
+ * Inputs (all binary, from X's point of view):
+ *  - 81 cells x 2 pieces
+ *  - 9 sub boards x 3 finished statuses (X won, O won, draw)
+ *  - 10 forced board states (one per sub board, plus "any board")
+ *  - 1 side to move (set when O has to play)
+ *
+ * The first layer is kept in an Accumulator that is updated with the
+ * few features a move changes instead of being recomputed. The search
+ * keeps the parent's accumulator around while it visits a child, so
+ * undoing a move is free. The following layers are small int8 layers.
+ */
+class Nnue {
+public:
+  static constexpr int s_inputs = 81 * 2 + 9 * 3 + 10 + 1;
+  static constexpr int s_l1 = 64;
+  static constexpr int s_l2 = 32;
+
+  // fixed point scales of the quantized layers
+  static constexpr int s_l2Shift = 6;
+  static constexpr int s_outputDivisor = 16;
+
+  struct alignas(32) Accumulator {
+    std::array<int16_t, s_l1> values;
+  };
+
+  /**
+   * Loads a network from the binary format written by Save
+   *
+   * @param path the weights file
+   * @return the network, or nullptr if the file is missing or invalid
+   */
+  static std::shared_ptr<const Nnue> Load(const std::string& path);
+  bool Save(const std::string& path) const;
+
+  /**
+   * Builds a network with small random weights, only useful
+   * to exercise the file format and to measure the speed
+   */
+  static std::shared_ptr<Nnue> Random(uint32_t seed);
+
+  // computes the accumulator of a position from scratch
+  void Refresh(const Board& board, Accumulator& acc) const;
+
+  /**
+   * Computes the accumulator of child from the one of its parent
+   *
+   * @param parent the position before the move
+   * @param move the move played in parent
+   * @param child the position after the move
+   */
+  void Update(const Board& parent,
+              const Move& move,
+              const Board& child,
+              const Accumulator& parentAcc,
+              Accumulator& childAcc) const;
+
+  // score of the position from the perspective of player X
+  int32_t Evaluate(const Accumulator& acc) const;
+
+  /**
+   * Same scores as Evaluate for count positions at once. Each row of
+   * weights is applied to every position before moving to the next, so
+   * the weights are read once per batch rather than once per position
+   *
+   * @param accs the accumulators of the positions
+   * @param scores receives the count scores
+   */
+  void EvaluateBatch(const Accumulator* const* accs, std::size_t count, int32_t* scores) const;
+
+private:
+  Nnue() = default;
+
+  static int CellFeature(Piece piece, int idx) { return (piece == Piece::X ? 0 : 81) + idx; }
+  static int BigBoardFeature(int boardPosition, GameStatus status);
+  static int ForcedBoardFeature(int forcedBoard) { return 81 * 2 + 9 * 3 + (forcedBoard < 0 ? 9 : forcedBoard); }
+  static constexpr int s_oToMoveFeature = s_inputs - 1;
+
+  alignas(32) std::array<int16_t, s_inputs * s_l1> m_featureWeights = {0};
+  alignas(32) std::array<int16_t, s_l1> m_featureBias = {0};
+  alignas(32) std::array<int8_t, s_l2 * s_l1> m_l2Weights = {0};
+  alignas(32) std::array<int32_t, s_l2> m_l2Bias = {0};
+  alignas(32) std::array<int8_t, s_l2> m_outputWeights = {0};
+  int32_t m_outputBias = 0;
+};
@@ -0,0 +1,98 @@
+#include "pch.h"
+#include "OpeningBook.h"
+
+// file layout, all values little endian:
+//   char[8]  magic "ETTTBOOK"
+//   uint32   version
+//   uint32   number of entries
+//   Entry    entries [count], sorted by key
+static constexpr char s_magic[8] = {'E', 'T', 'T', 'T', 'B', 'O', 'O', 'K'};
+static constexpr uint32_t s_version = 1;
+static constexpr std::size_t s_headerSize = 16;
+
+std::shared_ptr<const OpeningBook> OpeningBook::Load(const std::string& path) {
+  std::unique_ptr<MappedFile> file = MappedFile::Open(path);
+  if (!file)
+    return nullptr;
+
+  const uint8_t* data = file->GetData();
+  uint32_t header[2];
+  if (file->GetSize() < s_headerSize || !std::equal(s_magic, s_magic + 8, data)) {
+    SPDLOG_ERROR("{} is not a book file", path);
+    return nullptr;
+  }
+  std::memcpy(header, data + 8, sizeof(header));
+  if (header[0] != s_version) {
+    SPDLOG_ERROR("{} has version {}, expected version {}", path, header[0], s_version);
+    return nullptr;
+  }
+  if (file->GetSize() != s_headerSize + header[1] * sizeof(Entry)) {
+    SPDLOG_ERROR("{} should have {} entries but has {} bytes", path, header[1], file->GetSize());
+    return nullptr;
+  }
+
+  std::shared_ptr<OpeningBook> book(new OpeningBook());
+  // the header keeps the entries 8 byte aligned in the page aligned mapping
+  book->m_entries = reinterpret_cast<const Entry*>(data + s_headerSize);
+  book->m_count = header[1];
+  book->m_file = std::move(file);
+  SPDLOG_INFO("Mapped book {} with {} positions", path, book->m_count);
+  return book;
+}
+
+bool OpeningBook::Save(const std::string& path, std::vector<Entry> entries) {
+  std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+    return a.key < b.key;
+  });
+  std::ofstream os(path, std::ios::binary);
+  const uint32_t header[2] = {s_version, static_cast<uint32_t>(entries.size())};
+  os.write(s_magic, sizeof(s_magic));
+  os.write(reinterpret_cast<const char*>(header), sizeof(header));
+  os.write(reinterpret_cast<const char*>(entries.data()),
+           static_cast<std::streamsize>(entries.size() * sizeof(Entry)));
+  return static_cast<bool>(os);
+}
+
+std::pair<uint64_t, int> OpeningBook::GetCanonicalKeyAndSymmetry(const Board& board) {
+  std::pair<uint64_t, int> best = {board.GetKey(), 0};
+  for (int symmetry = 1; symmetry < Board::s_symmetryCount; symmetry++) {
+    uint64_t key = board.GetKey(symmetry);
+    if (key < best.first)
+      best = {key, symmetry};
+  }
+  return best;
+}
+
+uint64_t OpeningBook::GetCanonicalKey(const Board& board) {
+  return GetCanonicalKeyAndSymmetry(board).first;
+}
+
+OpeningBook::Entry OpeningBook::MakeEntry(const Board& board, const Move& move, int32_t score, int depth) {
+  auto [key, symmetry] = GetCanonicalKeyAndSymmetry(board);
+  Move canonical = Board::TransformMove(move, symmetry);
+  Entry entry;
+  entry.key = key;
+  entry.score = score;
+  entry.boardPosition = static_cast<uint8_t>(canonical.m_boardPosition);
+  entry.cellPosition = static_cast<uint8_t>(canonical.m_cellPosition);
+  entry.depth = static_cast<uint8_t>(depth);
+  return entry;
+}
+
+std::optional<OpeningBook::Hit> OpeningBook::Probe(const Board& board) const {
+  auto [key, symmetry] = GetCanonicalKeyAndSymmetry(board);
+  const Entry* end = m_entries + m_count;
+  const Entry* it = std::lower_bound(m_entries, end, key, [](const Entry& entry, uint64_t key) {
+    return entry.key < key;
+  });
+  if (it == end || it->key != key)
+    return std::nullopt;
+
+  // a symmetry of the position may map onto itself, any of them gives an equivalent move
+  Move move = Board::InverseTransformMove(Move(it->boardPosition, it->cellPosition), symmetry);
+  if (!board.IsMoveLegal(move)) {
+    SPDLOG_WARN("Ignoring illegal book move {}, the key collides", move);
+    return std::nullopt;
+  }
+  return Hit{move, it->score, it->depth};
+}
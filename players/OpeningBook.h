@@ -0,0 +1,65 @@
+#pragma once
+#include "../Board.h"
+#include "../MappedFile.h"
+
+/**
+ * Best moves of the first plies found by deep offline searches, see
+ * tools/BookBuilder.cpp. Symmetric positions share a single entry.
+ *
+ * The file is mapped into memory and searched in place, so loading
+ * is instant and the entries never end up on the heap.
+ */
+class OpeningBook {
+public:
+  // stored as is in the file, sorted by key
+  struct Entry {
+    uint64_t key;
+    int32_t score;
+    // the move in the position as seen under the symmetry with the smallest key
+    uint8_t boardPosition;
+    uint8_t cellPosition;
+    uint8_t depth;
+    uint8_t reserved = 0;
+  };
+  static_assert(sizeof(Entry) == 16, "book entries are written as is");
+
+  struct Hit {
+    Move move;
+    int32_t score;
+    int depth;
+  };
+
+  /**
+   * Maps a book file written by Save
+   *
+   * @return the book, or nullptr if the file is missing or invalid
+   */
+  static std::shared_ptr<const OpeningBook> Load(const std::string& path);
+  static bool Save(const std::string& path, std::vector<Entry> entries);
+
+  /**
+   * Makes the entry of a position, whatever symmetry it was found under
+   *
+   * @param move the best move in board
+   * @param score the score of that move for the player to move
+   * @param depth the depth it was searched at
+   */
+  static Entry MakeEntry(const Board& board, const Move& move, int32_t score, int depth);
+
+  // the key of the entry of a position, the same for all its symmetries
+  static uint64_t GetCanonicalKey(const Board& board);
+
+  // looks up a position, the move is checked to be legal
+  std::optional<Hit> Probe(const Board& board) const;
+  std::size_t GetSize() const { return m_count; }
+
+private:
+  OpeningBook() = default;
+
+  // smallest key among the symmetries of board, and the symmetry giving it
+  static std::pair<uint64_t, int> GetCanonicalKeyAndSymmetry(const Board& board);
+
+  std::unique_ptr<MappedFile> m_file;
+  const Entry* m_entries = nullptr;
+  std::size_t m_count = 0;
+};
@@ -1,6 +1,9 @@
 #pragma once
 #include "../Board.h"
 #include "../Move.h"
+#include "../Task.h"
+
+class GameScheduler;
 
 class Player {
 public:
@@ -31,6 +34,29 @@ public:
    */
   virtual Move GetMove() = 0;
 
+  /**
+   * Called before GetMove when the game is played with a clock,
+   * a player still thinking when it runs out loses the game
+   *
+   * @param remaining time left on the player's clock
+   * @param increment time added to the clock after the move
+   */
+  virtual void SetTimeLeft(
+      [[maybe_unused]] std::chrono::milliseconds remaining,
+      [[maybe_unused]] std::chrono::milliseconds increment){};
+
+  /**
+   * Requests the next move in a game run by a GameScheduler.
+   * A player waiting for something, like a click, overrides
+   * this to suspend instead of blocking a scheduler thread
+   *
+   * @param scheduler the scheduler running the game
+   * @return the next move
+   */
+  virtual Task<Move> GetMoveAsync([[maybe_unused]] GameScheduler& scheduler) {
+    co_return GetMove();
+  }
+
   /**
    * Called when the other player makes a move
    * so this player can update its state
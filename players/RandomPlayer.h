@@ -31,7 +31,10 @@ public:
   }
 
   virtual void ReceiveMove(const Move& move) override { m_board.Play(move); }
-  virtual void Reset() override {}
+  virtual void Reset() override {
+    m_board = Board();
+    m_isTerminated = false;
+  }
 
 private:
   PlayerSymbol m_player;
@@ -0,0 +1,141 @@
+#include "pch.h"
+#include "ScoreCache.h"
+#include "AIPlayer.h"
+
+// file layout, all values in the byte order of the machine that wrote
+// the file, since the keys are searched in place:
+//   char[8]   magic "ETTTSCOR"
+//   uint32    version
+//   uint32    reserved, 0
+//   uint64    evaluation stamp
+//   uint64    number of entries
+//   uint64    checksum of everything after the header
+//   uint64    keys   [count], sorted
+//   int16     scores [count], in the same order as the keys
+static constexpr char s_magic[8] = {'E', 'T', 'T', 'T', 'S', 'C', 'O', 'R'};
+static constexpr uint32_t s_version = 1;
+static constexpr std::size_t s_headerSize = 40;
+// how the version reads when the file comes from the other byte order
+static constexpr uint32_t s_swappedVersion =
+    (s_version >> 24) | ((s_version >> 8) & 0xff00) | ((s_version << 8) & 0xff0000) | (s_version << 24);
+
+struct Header {
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t evalStamp;
+  uint64_t count;
+  uint64_t checksum;
+};
+static_assert(sizeof(s_magic) + sizeof(Header) == s_headerSize);
+
+// FNV-1a over 8 byte words, fast enough to check a large file at startup
+static uint64_t Checksum(const uint8_t* data, std::size_t size) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  std::size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    std::memcpy(&word, data + i, sizeof(word));
+    hash = (hash ^ word) * 0x100000001b3ull;
+  }
+  for (; i < size; i++)
+    hash = (hash ^ data[i]) * 0x100000001b3ull;
+  return hash;
+}
+
+std::shared_ptr<const ScoreCache> ScoreCache::Load(const std::string& path) {
+  std::unique_ptr<MappedFile> file = MappedFile::Open(path);
+  if (!file)
+    return nullptr;
+
+  const uint8_t* data = file->GetData();
+  if (file->GetSize() < s_headerSize || !std::equal(s_magic, s_magic + 8, data)) {
+    SPDLOG_ERROR("{} is not a score cache file", path);
+    return nullptr;
+  }
+  Header header;
+  std::memcpy(&header, data + sizeof(s_magic), sizeof(header));
+  if (header.version == s_swappedVersion) {
+    SPDLOG_ERROR("{} was written on a machine with a different byte order", path);
+    return nullptr;
+  }
+  if (header.version != s_version) {
+    SPDLOG_ERROR("{} has version {}, expected version {}", path, header.version, s_version);
+    return nullptr;
+  }
+  const std::size_t payloadSize = header.count * (sizeof(uint64_t) + sizeof(int16_t));
+  if (file->GetSize() != s_headerSize + payloadSize) {
+    SPDLOG_ERROR("{} should have {} entries but has {} bytes", path, header.count, file->GetSize());
+    return nullptr;
+  }
+  if (Checksum(data + s_headerSize, payloadSize) != header.checksum) {
+    SPDLOG_ERROR("{} is corrupted, its checksum does not match", path);
+    return nullptr;
+  }
+
+  std::shared_ptr<ScoreCache> cache(new ScoreCache());
+  // the header keeps the keys 8 byte aligned in the page aligned mapping
+  cache->m_keys = reinterpret_cast<const uint64_t*>(data + s_headerSize);
+  cache->m_scores = reinterpret_cast<const int16_t*>(cache->m_keys + header.count);
+  cache->m_count = header.count;
+  cache->m_evalStamp = header.evalStamp;
+  cache->m_file = std::move(file);
+  SPDLOG_INFO("Mapped score cache {} with {} positions", path, cache->m_count);
+  return cache;
+}
+
+bool ScoreCache::Save(const std::string& path, uint64_t evalStamp, std::vector<Entry> entries, std::size_t maxEntries) {
+  std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+    return a.key < b.key;
+  });
+  entries.erase(std::unique(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+                  return a.key == b.key;
+                }),
+                entries.end());
+  if (entries.size() > maxEntries)
+    entries.resize(maxEntries);
+
+  std::vector<uint8_t> payload(entries.size() * (sizeof(uint64_t) + sizeof(int16_t)));
+  uint8_t* scores = payload.data() + entries.size() * sizeof(uint64_t);
+  for (std::size_t i = 0; i < entries.size(); i++) {
+    static_assert(s_winScore <= std::numeric_limits<int16_t>::max(), "cached scores are 16 bits");
+    int16_t score = static_cast<int16_t>(entries[i].score);
+    std::memcpy(payload.data() + i * sizeof(uint64_t), &entries[i].key, sizeof(uint64_t));
+    std::memcpy(scores + i * sizeof(int16_t), &score, sizeof(int16_t));
+  }
+  Header header = {s_version, 0, evalStamp, entries.size(), Checksum(payload.data(), payload.size())};
+
+  const std::string tmpPath = path + ".tmp";
+  {
+    std::ofstream os(tmpPath, std::ios::binary);
+    os.write(s_magic, sizeof(s_magic));
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    os.write(reinterpret_cast<const char*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+    if (!os) {
+      SPDLOG_ERROR("Could not write {}", tmpPath);
+      return false;
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(tmpPath, path, error);
+  if (error) {
+    // Windows does not replace a file that is still mapped
+    SPDLOG_ERROR("Could not replace {} with {}: {}", path, tmpPath, error.message());
+    return false;
+  }
+  return true;
+}
+
+std::optional<int32_t> ScoreCache::Probe(uint64_t key) const {
+  const uint64_t* end = m_keys + m_count;
+  const uint64_t* it = std::lower_bound(m_keys, end, key);
+  if (it == end || *it != key)
+    return std::nullopt;
+  return m_scores[it - m_keys];
+}
+
+std::vector<ScoreCache::Entry> ScoreCache::GetEntries() const {
+  std::vector<Entry> entries(m_count);
+  for (std::size_t i = 0; i < m_count; i++)
+    entries[i] = {m_keys[i], m_scores[i]};
+  return entries;
+}
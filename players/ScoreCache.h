@@ -0,0 +1,52 @@
+#pragma once
+#include "../MappedFile.h"
+
+/**
+ * Static evaluation scores saved by earlier sessions, so a new
+ * session does not start from a cold cache. Positions are identified
+ * by their Zobrist key only.
+ *
+ * The file is mapped into memory and searched in place. It is stamped
+ * with the evaluation it was computed with (see GetEvalStamp) and
+ * carries a checksum of its contents.
+ */
+class ScoreCache {
+public:
+  struct Entry {
+    uint64_t key;
+    int32_t score;
+  };
+
+  /**
+   * Maps a cache file written by Save and verifies its checksum
+   *
+   * @return the cache, or nullptr if the file is missing or invalid
+   */
+  static std::shared_ptr<const ScoreCache> Load(const std::string& path);
+
+  /**
+   * Writes entries to a new file and then moves it over path, so a
+   * mapping of the previous file stays valid. Duplicate keys keep
+   * their first entry.
+   *
+   * @param evalStamp stamp of the evaluation that computed the scores
+   * @param maxEntries only the entries with the smallest keys are kept
+   *                   beyond this, which amounts to a random sample
+   */
+  static bool Save(const std::string& path, uint64_t evalStamp, std::vector<Entry> entries, std::size_t maxEntries);
+
+  std::optional<int32_t> Probe(uint64_t key) const;
+  std::vector<Entry> GetEntries() const;
+  uint64_t GetEvalStamp() const { return m_evalStamp; }
+  std::size_t GetSize() const { return m_count; }
+
+private:
+  ScoreCache() = default;
+
+  std::unique_ptr<MappedFile> m_file;
+  uint64_t m_evalStamp = 0;
+  // sorted keys, and the scores in the same order
+  const uint64_t* m_keys = nullptr;
+  const int16_t* m_scores = nullptr;
+  std::size_t m_count = 0;
+};
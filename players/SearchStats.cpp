@@ -0,0 +1,85 @@
+#include "pch.h"
+#include "SearchStats.h"
+#include "Allocations.h"
+
+void SearchStats::Merge(const SearchStats& other) {
+  nodes += other.nodes;
+  leafEvaluations += other.leafEvaluations;
+  cacheProbes += other.cacheProbes;
+  cacheHits += other.cacheHits;
+  cutoffs += other.cutoffs;
+  firstMoveCutoffs += other.firstMoveCutoffs;
+  pvsResearches += other.pvsResearches;
+  aspirationResearches += other.aspirationResearches;
+  lmrReductions += other.lmrReductions;
+  lmrResearches += other.lmrResearches;
+  extensions += other.extensions;
+  allocations += other.allocations;
+  allocatedBytes += other.allocatedBytes;
+  treeAllocations += other.treeAllocations;
+  scoreMapAllocations += other.scoreMapAllocations;
+  depth = std::max(depth, other.depth);
+  for (int ply = 0; ply < s_maxPly; ply++) {
+    expandedNodes[ply] += other.expandedNodes[ply];
+    childNodes[ply] += other.childNodes[ply];
+  }
+  elapsed += other.elapsed;
+}
+
+static double Ratio(uint64_t numerator, uint64_t denominator) {
+  return denominator ? static_cast<double>(numerator) / static_cast<double>(denominator) : 0.0;
+}
+
+double SearchStats::CacheHitRatio() const { return Ratio(cacheHits, cacheProbes); }
+
+double SearchStats::FirstMoveCutoffRate() const { return Ratio(firstMoveCutoffs, cutoffs); }
+
+double SearchStats::BranchingFactor(int ply) const {
+  return Ratio(childNodes[ply], expandedNodes[ply]);
+}
+
+double SearchStats::NodesPerSecond() const {
+  double seconds = std::chrono::duration<double>(elapsed).count();
+  return seconds > 0 ? static_cast<double>(nodes) / seconds : 0.0;
+}
+
+std::ostream& operator<<(std::ostream& out, const SearchStats& stats) {
+  // format in a separate stream so the caller's flags are left untouched
+  std::ostringstream os;
+  os << std::fixed << std::setprecision(3)
+     << "depth=" << stats.depth
+     << " nodes=" << stats.nodes
+     << " leaves=" << stats.leafEvaluations
+     << " cache_probes=" << stats.cacheProbes
+     << " cache_hits=" << stats.cacheHits
+     << " cache_hit_ratio=" << stats.CacheHitRatio()
+     << " cutoffs=" << stats.cutoffs
+     << " first_move_cutoff_rate=" << stats.FirstMoveCutoffRate()
+     << " pvs_researches=" << stats.pvsResearches
+     << " aspiration_researches=" << stats.aspirationResearches
+     << " lmr_reductions=" << stats.lmrReductions
+     << " lmr_researches=" << stats.lmrResearches
+     << " extensions=" << stats.extensions;
+  if (Allocations::IsTracking()) {
+    os << " allocations=" << stats.allocations
+       << " allocated_bytes=" << stats.allocatedBytes
+       << " tree_allocations=" << stats.treeAllocations
+       << " score_map_allocations=" << stats.scoreMapAllocations;
+  }
+  os << " branching=[";
+
+  // only print the plies the search actually reached
+  int deepest = SearchStats::s_maxPly - 1;
+  while (deepest > 0 && stats.expandedNodes[deepest] == 0)
+    deepest--;
+  for (int ply = 0; ply <= deepest; ply++) {
+    if (ply)
+      os << ",";
+    os << std::setprecision(2) << stats.BranchingFactor(ply);
+  }
+
+  os << "]" << std::setprecision(3)
+     << " time_ms=" << std::chrono::duration<double, std::milli>(stats.elapsed).count()
+     << " nps=" << static_cast<uint64_t>(stats.NodesPerSecond());
+  return out << os.str();
+}
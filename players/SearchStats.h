@@ -0,0 +1,67 @@
+#pragma once
+
+/**
+ * Counters collected while searching for a single move.
+ * Each search thread accumulates into its own thread local instance
+ * and the results are merged once the search is over, so nothing in
+ * the hot path is shared between threads.
+ */
+struct SearchStats {
+  static constexpr int s_maxPly = 32;
+
+  // number of positions visited by the search
+  uint64_t nodes = 0;
+  // number of positions scored by the static analysis
+  uint64_t leafEvaluations = 0;
+  // score cache lookups and successful lookups
+  uint64_t cacheProbes = 0;
+  uint64_t cacheHits = 0;
+  // beta cutoffs, and how many of them happened on the first move tried
+  uint64_t cutoffs = 0;
+  uint64_t firstMoveCutoffs = 0;
+  // null window searches that had to be repeated with the full window
+  uint64_t pvsResearches = 0;
+  // root searches repeated because the score fell outside the aspiration window
+  uint64_t aspirationResearches = 0;
+  // late quiet moves searched at a reduced depth, and how many of them
+  // did better than expected and were searched again at full depth
+  uint64_t lmrReductions = 0;
+  uint64_t lmrResearches = 0;
+  // forcing moves searched deeper than the others
+  uint64_t extensions = 0;
+  // heap allocations of the search and their bytes, and the allocations made
+  // below the root moves, which should be none once the player is warmed up.
+  // Only counted when allocation tracking is compiled in, see Allocations.h
+  uint64_t allocations = 0;
+  uint64_t allocatedBytes = 0;
+  uint64_t treeAllocations = 0;
+  // allocations of the score map, which keeps every new position it scores, so it
+  // grows for as long as the game goes on. They are not part of treeAllocations
+  uint64_t scoreMapAllocations = 0;
+  // deepest completed iteration, in plies from the root
+  int depth = 0;
+  // per ply: how many nodes were expanded and how many children they had
+  std::array<uint64_t, s_maxPly> expandedNodes = {0};
+  std::array<uint64_t, s_maxPly> childNodes = {0};
+
+  std::chrono::nanoseconds elapsed{0};
+
+  void Merge(const SearchStats& other);
+  void RecordExpansion(int ply, std::size_t children) {
+    int idx = std::min(ply, s_maxPly - 1);
+    expandedNodes[idx]++;
+    childNodes[idx] += children;
+  }
+
+  double CacheHitRatio() const;
+  double FirstMoveCutoffRate() const;
+  double BranchingFactor(int ply) const;
+  double NodesPerSecond() const;
+};
+
+/**
+ * Writes the statistics as a single line of space separated key=value pairs
+ */
+std::ostream& operator<<(std::ostream& os, const SearchStats& stats);
+template <>
+struct fmt::formatter<SearchStats> : fmt::ostream_formatter {};
@@ -0,0 +1,28 @@
+#include "pch.h"
+#include "SharedScoreCache.h"
+
+SharedScoreCache::SharedScoreCache(std::size_t entries, uint64_t evalStamp)
+    : m_evalStamp(evalStamp), m_entries(std::bit_ceil(std::max<std::size_t>(entries, s_stripes))) {}
+
+std::optional<int32_t> SharedScoreCache::Probe(uint64_t key) const {
+  const std::size_t index = GetIndex(key);
+  std::lock_guard<std::mutex> lock(GetMutex(index));
+  const Entry& entry = m_entries[index];
+  if (entry.score == s_emptyScore || entry.key != key)
+    return std::nullopt;
+  return entry.score;
+}
+
+void SharedScoreCache::Store(uint64_t key, int32_t score) {
+  const std::size_t index = GetIndex(key);
+  std::lock_guard<std::mutex> lock(GetMutex(index));
+  m_entries[index] = {key, score};
+}
+
+void SharedScoreCache::Clear() {
+  for (Stripe& stripe : m_stripes)
+    stripe.mutex.lock();
+  std::fill(m_entries.begin(), m_entries.end(), Entry());
+  for (Stripe& stripe : m_stripes)
+    stripe.mutex.unlock();
+}
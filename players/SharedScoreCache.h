@@ -0,0 +1,52 @@
+#pragma once
+
+/**
+ * Static evaluation scores shared by players searching on different
+ * threads, with a fixed number of entries. Positions are identified by
+ * their Zobrist key only, and a new score replaces the one of any other
+ * position in its slot.
+ *
+ * The slots are split into stripes with a mutex each, neighbouring slots
+ * belonging to different stripes, so concurrent searches rarely wait for
+ * each other. Players only share a cache if they use the same evaluation
+ * (see GetEvalStamp).
+ */
+class SharedScoreCache {
+public:
+  /**
+   * @param entries number of slots, rounded up to a power of two
+   * @param evalStamp stamp of the evaluation computing the scores
+   */
+  SharedScoreCache(std::size_t entries, uint64_t evalStamp);
+
+  SharedScoreCache(const SharedScoreCache&) = delete;
+  SharedScoreCache& operator=(const SharedScoreCache&) = delete;
+
+  std::optional<int32_t> Probe(uint64_t key) const;
+  void Store(uint64_t key, int32_t score);
+  void Clear();
+
+  uint64_t GetEvalStamp() const { return m_evalStamp; }
+  std::size_t GetCapacity() const { return m_entries.size(); }
+
+private:
+  static constexpr std::size_t s_stripes = 64;
+  // marks an empty slot, no evaluation returns it
+  static constexpr int32_t s_emptyScore = std::numeric_limits<int32_t>::min();
+
+  struct Entry {
+    uint64_t key = 0;
+    int32_t score = s_emptyScore;
+  };
+  // a cache line each, so the threads do not share them
+  struct alignas(64) Stripe {
+    mutable std::mutex mutex;
+  };
+
+  std::size_t GetIndex(uint64_t key) const { return key & (m_entries.size() - 1); }
+  std::mutex& GetMutex(std::size_t index) const { return m_stripes[index % s_stripes].mutex; }
+
+  uint64_t m_evalStamp;
+  std::vector<Entry> m_entries;
+  std::array<Stripe, s_stripes> m_stripes;
+};
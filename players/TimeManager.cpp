@@ -0,0 +1,34 @@
+#include "pch.h"
+#include "TimeManager.h"
+
+// kept on the clock for what happens around the search, e.g. the game loop
+static constexpr std::chrono::milliseconds s_overhead{10};
+
+TimeManager::TimeManager(const Board& board, std::chrono::milliseconds remaining, std::chrono::milliseconds increment) {
+  int emptyCells = 0;
+  for (int idx = 0; idx < 9 * 9; idx++)
+    emptyCells += board.GetPieceAt(idx / 9, idx % 9) == Piece::Empty;
+  // most games end with a third of the cells still empty, and each player
+  // plays every other move, so this is the moves left to the player, roughly
+  const int movesLeft = std::clamp(emptyCells / 3, 4, 30);
+
+  const std::chrono::milliseconds available = std::max(remaining - s_overhead, std::chrono::milliseconds(1));
+  m_hard = std::max(std::min(available / 3, available / movesLeft * 5 + increment), std::chrono::milliseconds(1));
+  m_soft = std::clamp(available / movesLeft + increment * 3 / 4, std::chrono::milliseconds(1), m_hard);
+}
+
+bool TimeManager::OnIteration(const Move& bestMove, std::chrono::steady_clock::duration elapsed) {
+  if (m_bestMove == bestMove)
+    m_stableIterations++;
+  else
+    m_stableIterations = 0;
+  const bool hasChanged = m_bestMove.has_value() && m_stableIterations == 0;
+  m_bestMove = bestMove;
+
+  // a best move that just changed deserves a closer look,
+  // one that survived several iterations is unlikely to change
+  double scale = hasChanged ? 1.5 : std::max(0.5, 1.0 - 0.1 * m_stableIterations);
+  // each iteration takes longer than all the previous ones together,
+  // so the next one would not end in time once half the budget is gone
+  return elapsed * 2 >= std::chrono::duration_cast<std::chrono::steady_clock::duration>(m_soft * scale);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "../Board.h"
+
+/**
+ * Splits the time left on a player's clock between the moves still to
+ * play. The soft budget is what a move should take: no iteration is
+ * started once the next one would likely end past it. It shrinks while
+ * the best move stays the same between iterations and grows when it
+ * changes. The hard budget stops the search in the middle of an
+ * iteration, well before the clock runs out.
+ */
+class TimeManager {
+public:
+  /**
+   * @param board the position to move in
+   * @param remaining time left on the clock
+   * @param increment time added to the clock after the move
+   */
+  TimeManager(const Board& board, std::chrono::milliseconds remaining, std::chrono::milliseconds increment);
+
+  std::chrono::milliseconds GetSoftBudget() const { return m_soft; }
+  std::chrono::milliseconds GetHardBudget() const { return m_hard; }
+
+  /**
+   * Called after every completed iteration of the search
+   *
+   * @param bestMove the best move of the iteration
+   * @param elapsed time since the search started
+   * @return true if no further iteration should be started
+   */
+  bool OnIteration(const Move& bestMove, std::chrono::steady_clock::duration elapsed);
+
+private:
+  std::chrono::milliseconds m_soft;
+  std::chrono::milliseconds m_hard;
+  std::optional<Move> m_bestMove;
+  // completed iterations in a row that found the same best move
+  int m_stableIterations = 0;
+};
@@ -0,0 +1,220 @@
+// Searches every position of a file, e.g. to analyse the games of a
+// database, on all cores.
+//
+//   analyzer <positions> [--out file] [--engine config] [--depth n] [--time ms] [--nodes n] [--multipv k] [--threads n]
+//
+// Positions are read one per line, either in the one line notation of
+// Board::FromNotation or as the 81 cells read row by row followed by the
+// board and cell of the last move, as written by tuner generate:
+//
+//   9/9/9/9/4x4/9/9/9/9 o 4
+//   ....(81 cells)....  4 4
+//
+// Empty lines and lines starting with # are skipped. Every position gets
+// one output line, in the order of the input, with its moves written as
+// board and cell:
+//
+//   line=1 best=40 score=12 depth=8 nodes=50211 time_ms=28.4 pv=40,04,44,...
+//
+// With --multipv the next best moves follow, as move2=44 score2=3 pv2=...
+#include "pch.h"
+
+#include "players/AIPlayer.h"
+
+struct Options {
+  std::string outPath;
+  AIConfig engine;
+  SearchLimits limits;
+  int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+};
+
+static void PrintUsage() {
+  fmt::print(
+      "usage: analyzer <positions> [--out file] [--engine config] [--depth n] [--time ms] [--nodes n] [--multipv k]\n"
+      "                [--threads n]\n");
+}
+
+static Options ParseOptions(int first, int argc, char** argv) {
+  Options options;
+  for (int i = first; i < argc; i++) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc)
+      throw std::invalid_argument("Missing value for " + arg);
+    std::string value = argv[++i];
+
+    if (arg == "--out")
+      options.outPath = value;
+    else if (arg == "--engine")
+      options.engine = AIConfig::Parse(value);
+    else if (arg == "--depth")
+      options.limits.depth = std::stoi(value);
+    else if (arg == "--time")
+      options.limits.time = std::chrono::milliseconds(std::stoll(value));
+    else if (arg == "--nodes")
+      options.limits.nodes = std::stoull(value);
+    else if (arg == "--multipv")
+      options.limits.multiPv = std::clamp(std::stoi(value), 1, 9 * 9);
+    else if (arg == "--threads")
+      options.threads = std::max(1, std::stoi(value));
+    else
+      throw std::invalid_argument("Unknown option " + arg);
+  }
+  return options;
+}
+
+/**
+ * @throws std::invalid_argument if line is not a position
+ */
+static Board ParsePosition(const std::string& line) {
+  if (line.find('/') != std::string::npos)
+    return Board::FromNotation(line);
+
+  std::istringstream ss(line);
+  std::string cells;
+  int boardPosition = -1;
+  int cellPosition = -1;
+  ss >> cells >> boardPosition >> cellPosition;
+  if (cells.size() != 81 || boardPosition < 0 || boardPosition > 8 || cellPosition < 0 || cellPosition > 8)
+    throw std::invalid_argument("Expected 81 cells and the last move: " + line);
+  // the board string constructor trusts its input
+  auto xCount = std::count(cells.begin(), cells.end(), 'x');
+  auto oCount = std::count(cells.begin(), cells.end(), 'o');
+  if (xCount < oCount || xCount > oCount + 1)
+    throw std::invalid_argument("Invalid piece counts: " + line);
+  Board board(cells, Move(boardPosition, cellPosition));
+  Piece lastPiece = board.GetOtherPlayer() == PlayerSymbol::X ? Piece::X : Piece::O;
+  if (board.GetPieceAt(boardPosition, cellPosition) != lastPiece)
+    throw std::invalid_argument("The last move is not a piece of the previous player: " + line);
+  return board;
+}
+
+static std::string FormatMove(const Move& move) {
+  return fmt::format("{}{}", move.m_boardPosition, move.m_cellPosition);
+}
+
+static std::string Analyze(AIPlayer& player, const std::string& line, std::size_t lineNumber,
+                           const SearchLimits& limits) {
+  Board board;
+  try {
+    board = ParsePosition(line);
+  } catch (const std::exception& e) {
+    return fmt::format("line={} error=\"{}\"\n", lineNumber, e.what());
+  }
+  std::optional<SearchResult> result = player.Analyze(board, limits);
+  if (!result)
+    return fmt::format("line={} result={}\n", lineNumber, board.GetTopGameStatus());
+
+  auto formatPv = [](const std::vector<Move>& moves) {
+    std::string pv;
+    for (const Move& move : moves) {
+      // appended piece by piece, GCC 12 warns about the temporary of "," + FormatMove
+      if (!pv.empty())
+        pv += ',';
+      pv += FormatMove(move);
+    }
+    return pv;
+  };
+  std::string output = fmt::format("line={} best={} score={} depth={} nodes={} time_ms={:.1f} pv={}", lineNumber,
+                                   FormatMove(result->move), result->score, result->stats.depth, result->stats.nodes,
+                                   std::chrono::duration<double, std::milli>(result->stats.elapsed).count(),
+                                   formatPv(result->pv));
+  for (std::size_t i = 1; i < result->lines.size(); i++) {
+    const PvLine& pvLine = result->lines[i];
+    output += fmt::format(" move{0}={1} score{0}={2} pv{0}={3}", i + 1, FormatMove(pvLine.move), pvLine.score,
+                          formatPv(pvLine.pv));
+  }
+  return output + "\n";
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    PrintUsage();
+    return 1;
+  }
+  Options options;
+  try {
+    options = ParseOptions(2, argc, argv);
+  } catch (const std::exception& e) {
+    fmt::print(stderr, "{}\n", e.what());
+    PrintUsage();
+    return 1;
+  }
+  spdlog::set_level(spdlog::level::warn);
+
+  std::ifstream in(argv[1]);
+  if (!in) {
+    fmt::print(stderr, "Could not open {}\n", argv[1]);
+    return 1;
+  }
+  // line numbers of the positions, and the positions
+  std::vector<std::pair<std::size_t, std::string>> lines;
+  std::string line;
+  for (std::size_t lineNumber = 1; std::getline(in, line); lineNumber++) {
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+    if (!line.empty() && line[0] != '#')
+      lines.emplace_back(lineNumber, line);
+  }
+
+  std::ofstream outFile;
+  if (!options.outPath.empty()) {
+    outFile.open(options.outPath);
+    if (!outFile) {
+      fmt::print(stderr, "Could not open {}\n", options.outPath);
+      return 1;
+    }
+  }
+  std::ostream& out = options.outPath.empty() ? std::cout : outFile;
+
+  // the workers take the positions in order but finish them in any order,
+  // the main thread writes each result as soon as the ones before it are written
+  std::mutex resultsMutex;
+  std::condition_variable resultReady;
+  std::vector<std::optional<std::string>> results(lines.size());
+  std::atomic<std::size_t> nextLine = 0;
+  auto worker = [&] {
+    AIPlayer player(options.engine);
+    std::size_t index;
+    while ((index = nextLine++) < lines.size()) {
+      // the scores cached for the previous positions slow down the lookups as they pile up, and
+      // the order the positions are searched in does not change the results. With a cache file
+      // they are kept instead, the player hands them over once when the worker is done rather
+      // than taking the lock of the cache file for every position
+      if (options.engine.cachePath.empty())
+        player.Reset();
+      std::string result = Analyze(player, lines[index].second, lines[index].first, options.limits);
+      {
+        std::lock_guard<std::mutex> lock(resultsMutex);
+        results[index] = std::move(result);
+      }
+      resultReady.notify_one();
+    }
+  };
+
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < options.threads; i++)
+    threads.emplace_back(worker);
+
+  for (std::size_t i = 0; i < results.size(); i++) {
+    std::string result;
+    {
+      std::unique_lock<std::mutex> lock(resultsMutex);
+      resultReady.wait(lock, [&] { return results[i].has_value(); });
+      result = std::move(*results[i]);
+      results[i].reset();
+    }
+    out << result;
+    // lets a reader follow the analysis as it progresses
+    out.flush();
+  }
+  for (std::thread& thread : threads)
+    thread.join();
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  SearchStats total = AIPlayer::GetTotalSearchStats();
+  fmt::print(stderr, "Analyzed {} positions in {:.1f}s with {} threads, nodes={} nps={:.0f}\n", lines.size(),
+             seconds, options.threads, total.nodes, total.nodes / std::max(seconds, 1e-9));
+  AIPlayer::SaveScoreCaches();
+  return 0;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "../Board.h"
+
+// Helpers shared by the benchmark tools, so they measure and pick their
+// positions the same way
+
+/**
+ * Plays a pseudo random legal move. Only mt19937 itself is used, not the
+ * standard distributions, so the moves are the same with every standard
+ * library.
+ */
+inline void PlayRandomMove(Board& board, std::mt19937& rng) {
+  std::vector<Move> moves = board.GetLegalMoves();
+  board.Play(moves[rng() % moves.size()]);
+}
+
+/**
+ * Positions reached by pseudo random play from the empty board, except
+ * the ones where the game is already over
+ *
+ * @param plies the number of random moves of each position
+ */
+inline std::vector<Board> GetRandomPositions(uint32_t seed, std::initializer_list<int> plies) {
+  std::vector<Board> positions;
+  std::mt19937 rng(seed);
+  for (int count : plies) {
+    Board board;
+    for (int ply = 0; ply < count && !board.IsGameOver(); ply++)
+      PlayRandomMove(board, rng);
+    if (!board.IsGameOver())
+      positions.push_back(board);
+  }
+  return positions;
+}
+
+/**
+ * Runs the benchmark repeat times and keeps the fastest run,
+ * which is the least disturbed by the rest of the system
+ *
+ * @return the best time in seconds
+ */
+template <typename F>
+double Measure(int repeat, F&& run) {
+  double best = std::numeric_limits<double>::max();
+  for (int i = 0; i < repeat; i++) {
+    const auto start = std::chrono::steady_clock::now();
+    run();
+    best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  }
+  return best;
+}
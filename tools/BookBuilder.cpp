@@ -0,0 +1,132 @@
+// Builds an opening book (players/OpeningBook.h) by searching every
+// position of the first plies deeply, once per symmetry class.
+//
+//   bookbuilder <book> [--plies n] [--engine config] [--threads n]
+//
+// The engine plays from the book with book=<file>.
+#include "pch.h"
+
+#include "players/AIPlayer.h"
+#include "players/OpeningBook.h"
+
+struct Options {
+  int plies = 2;
+  AIConfig engine = AIConfig::Parse("depth=8");
+  int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+};
+
+static void PrintUsage() {
+  fmt::print("usage: bookbuilder <book> [--plies n] [--engine config] [--threads n]\n");
+}
+
+static Options ParseOptions(int first, int argc, char** argv) {
+  Options options;
+  for (int i = first; i < argc; i++) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc)
+      throw std::invalid_argument("Missing value for " + arg);
+    std::string value = argv[++i];
+
+    if (arg == "--plies")
+      options.plies = std::stoi(value);
+    else if (arg == "--engine")
+      options.engine = AIConfig::Parse(value);
+    else if (arg == "--threads")
+      options.threads = std::max(1, std::stoi(value));
+    else
+      throw std::invalid_argument("Unknown option " + arg);
+  }
+  if (options.plies < 0)
+    throw std::invalid_argument("Expected a non negative number of plies");
+  return options;
+}
+
+/**
+ * Positions in progress up to plies moves from the empty board, only
+ * the first one found of each symmetry class is kept
+ */
+static std::vector<Board> GetPositions(int plies) {
+  std::vector<Board> positions;
+  std::unordered_set<uint64_t> seen;
+  std::vector<Board> current = {Board()};
+  seen.insert(OpeningBook::GetCanonicalKey(current.front()));
+  for (int ply = 0; ply <= plies; ply++) {
+    std::vector<Board> next;
+    for (const Board& board : current) {
+      positions.push_back(board);
+      if (ply == plies)
+        continue;
+      for (const Move& move : board.GetLegalMoves()) {
+        Board child = board;
+        child.Play(move);
+        if (!child.IsGameOver() && seen.insert(OpeningBook::GetCanonicalKey(child)).second)
+          next.push_back(child);
+      }
+    }
+    current = std::move(next);
+  }
+  return positions;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    PrintUsage();
+    return 1;
+  }
+  spdlog::set_level(spdlog::level::warn);
+
+  const std::string path = argv[1];
+  Options options;
+  try {
+    options = ParseOptions(2, argc, argv);
+  } catch (const std::exception& e) {
+    fmt::print(stderr, "{}\n", e.what());
+    PrintUsage();
+    return 1;
+  }
+  if (!options.engine.bookPath.empty()) {
+    fmt::print(stderr, "The engine building the book cannot use a book itself\n");
+    return 1;
+  }
+
+  const std::vector<Board> positions = GetPositions(options.plies);
+  fmt::print("Searching {} positions at depth {} on {} threads\n", positions.size(),
+             options.engine.depth, options.threads);
+
+  std::vector<OpeningBook::Entry> entries(positions.size());
+  std::atomic<std::size_t> nextPosition = 0;
+  std::atomic<std::size_t> done = 0;
+  std::mutex printMutex;
+  const auto start = std::chrono::steady_clock::now();
+  auto worker = [&] {
+    std::size_t index;
+    while ((index = nextPosition++) < positions.size()) {
+      const Board& board = positions[index];
+      // a fresh player per position, so no cached scores leak between them
+      AIPlayer player(options.engine);
+      player.Initialize(board.GetCurrentPlayer(), board);
+      Move move = player.GetMove();
+      entries[index] = OpeningBook::MakeEntry(board, move, player.GetLastScore(), options.engine.depth);
+
+      std::lock_guard<std::mutex> lock(printMutex);
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      fmt::print("\r{}/{} positions, {:.0f}s", ++done, positions.size(), seconds);
+      std::fflush(stdout);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < options.threads; i++)
+    threads.emplace_back(worker);
+  for (std::thread& thread : threads)
+    thread.join();
+  fmt::print("\n");
+  AIPlayer::SaveScoreCaches();
+
+  if (!OpeningBook::Save(path, std::move(entries))) {
+    fmt::print(stderr, "Could not write {}\n", path);
+    return 1;
+  }
+  fmt::print("Wrote {} positions to {}\n", positions.size(), path);
+  return 0;
+}
@@ -0,0 +1,74 @@
+// Merges score caches (players/ScoreCache.h), e.g. those written by
+// several self-play workers, into a single file.
+//
+//   cachemerge <out> <in>... [--max-entries n]
+//
+// Every input must have been made with the same evaluation as the
+// first one that can be read, the others are skipped. The output may
+// be one of the inputs.
+#include "pch.h"
+
+#include "players/ScoreCache.h"
+
+static void PrintUsage() {
+  fmt::print("usage: cachemerge <out> <in>... [--max-entries n]\n");
+}
+
+int main(int argc, char** argv) {
+  std::string outPath;
+  std::vector<std::string> inPaths;
+  std::size_t maxEntries = 1 << 22;
+  try {
+    for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+      if (arg == "--max-entries") {
+        if (i + 1 >= argc)
+          throw std::invalid_argument("Missing value for " + arg);
+        maxEntries = std::stoull(argv[++i]);
+      } else if (outPath.empty()) {
+        outPath = arg;
+      } else {
+        inPaths.push_back(arg);
+      }
+    }
+    if (inPaths.empty())
+      throw std::invalid_argument("Expected an output and at least one input");
+  } catch (const std::exception& e) {
+    fmt::print(stderr, "{}\n", e.what());
+    PrintUsage();
+    return 1;
+  }
+  spdlog::set_level(spdlog::level::warn);
+
+  std::optional<uint64_t> evalStamp;
+  std::string stampPath;
+  std::vector<ScoreCache::Entry> entries;
+  for (const std::string& path : inPaths) {
+    std::shared_ptr<const ScoreCache> cache = ScoreCache::Load(path);
+    if (!cache) {
+      fmt::print(stderr, "Skipping {}, it cannot be read\n", path);
+      continue;
+    }
+    if (!evalStamp) {
+      evalStamp = cache->GetEvalStamp();
+      stampPath = path;
+    }
+    if (cache->GetEvalStamp() != *evalStamp) {
+      fmt::print(stderr, "Skipping {}, it was made with another evaluation than {}\n", path, stampPath);
+      continue;
+    }
+    std::vector<ScoreCache::Entry> cacheEntries = cache->GetEntries();
+    entries.insert(entries.end(), cacheEntries.begin(), cacheEntries.end());
+    fmt::print("{}: {} positions\n", path, cache->GetSize());
+  }
+  if (!evalStamp) {
+    fmt::print(stderr, "None of the inputs could be read\n");
+    return 1;
+  }
+
+  if (!ScoreCache::Save(outPath, *evalStamp, std::move(entries), maxEntries))
+    return 1;
+  std::shared_ptr<const ScoreCache> merged = ScoreCache::Load(outPath);
+  fmt::print("Wrote {} positions to {}\n", merged ? merged->GetSize() : 0, outPath);
+  return merged ? 0 : 1;
+}
@@ -0,0 +1,176 @@
+// Compares playing moves with the player to move known at compile time,
+// as the search does, against looking it up at run time with
+// Board::PlayDynamic, with a perft and with a plain alpha-beta search
+// over the same positions.
+//
+//   dispatchbench [--perft-depth n] [--search-depth n] [--repeat n]
+#include "pch.h"
+
+#include "BenchUtils.h"
+#include "players/AIPlayer.h"
+
+// the run time versions look up the player to move for every move
+static uint64_t PerftDynamic(const Board& board, int depth) {
+  if (depth == 0 || board.IsGameOver())
+    return 1;
+  uint64_t nodes = 0;
+  for (int idx = 0; idx < 9 * 9; idx++) {
+    Move move = ConvertIdxToMove(idx);
+    if (!board.IsMoveLegal(move))
+      continue;
+    Board child = board;
+    child.PlayDynamic(move);
+    nodes += PerftDynamic(child, depth - 1);
+  }
+  return nodes;
+}
+
+template <PlayerSymbol Us>
+static uint64_t PerftStatic(const Board& board, int depth) {
+  if (depth == 0 || board.IsGameOver())
+    return 1;
+  uint64_t nodes = 0;
+  for (int idx = 0; idx < 9 * 9; idx++) {
+    Move move = ConvertIdxToMove(idx);
+    if (!board.IsMoveLegal(move))
+      continue;
+    Board child = board;
+    child.Play<Us>(move);
+    nodes += PerftStatic<Opponent(Us)>(child, depth - 1);
+  }
+  return nodes;
+}
+
+static Score NegamaxDynamic(const Board& board, const EvalWeights& weights, int depth, Score alpha, Score beta,
+                            uint64_t& nodes) {
+  nodes++;
+  if (depth == 0 || board.IsGameOver()) {
+    Score score = AIPlayer::CalcStaticAnalysis(board, weights);
+    return board.GetCurrentPlayer() == PlayerSymbol::X ? score : -score;
+  }
+
+  Score bestValue = -s_infinity;
+  for (int idx = 0; idx < 9 * 9 && alpha < beta; idx++) {
+    Move move = ConvertIdxToMove(idx);
+    if (!board.IsMoveLegal(move))
+      continue;
+    Board child = board;
+    child.PlayDynamic(move);
+    Score value = -NegamaxDynamic(child, weights, depth - 1, -beta, -alpha, nodes);
+    bestValue = std::max(bestValue, value);
+    alpha = std::max(alpha, value);
+  }
+  return bestValue;
+}
+
+template <PlayerSymbol Us>
+static Score NegamaxStatic(const Board& board, const EvalWeights& weights, int depth, Score alpha, Score beta,
+                           uint64_t& nodes) {
+  nodes++;
+  if (depth == 0 || board.IsGameOver()) {
+    if constexpr (Us == PlayerSymbol::X)
+      return AIPlayer::CalcStaticAnalysis(board, weights);
+    else
+      return -AIPlayer::CalcStaticAnalysis(board, weights);
+  }
+
+  Score bestValue = -s_infinity;
+  for (int idx = 0; idx < 9 * 9 && alpha < beta; idx++) {
+    Move move = ConvertIdxToMove(idx);
+    if (!board.IsMoveLegal(move))
+      continue;
+    Board child = board;
+    child.Play<Us>(move);
+    Score value = -NegamaxStatic<Opponent(Us)>(child, weights, depth - 1, -beta, -alpha, nodes);
+    bestValue = std::max(bestValue, value);
+    alpha = std::max(alpha, value);
+  }
+  return bestValue;
+}
+
+/**
+ * @param run returns the number of nodes it visited
+ * @return the number of nodes and the best time in seconds, see Measure
+ */
+template <typename F>
+static std::pair<uint64_t, double> MeasureNodes(int repeat, F&& run) {
+  uint64_t nodes = 0;
+  double best = Measure(repeat, [&] { nodes = run(); });
+  return {nodes, best};
+}
+
+static void Report(const char* name, std::pair<uint64_t, double> dynamic, std::pair<uint64_t, double> compiled) {
+  if (dynamic.first != compiled.first) {
+    fmt::print(stderr, "{}: the versions disagree, {} nodes at run time and {} at compile time\n",
+               name, dynamic.first, compiled.first);
+    std::exit(1);
+  }
+  fmt::print("{:<8} nodes={} run_time_ms={:.1f} compile_time_ms={:.1f} speedup={:.2f}\n", name, dynamic.first,
+             dynamic.second * 1000, compiled.second * 1000, dynamic.second / compiled.second);
+}
+
+int main(int argc, char** argv) {
+  int perftDepth = 5;
+  int searchDepth = 7;
+  int repeat = 3;
+  try {
+    for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+      if (i + 1 >= argc)
+        throw std::invalid_argument("Missing value for " + arg);
+      int value = std::stoi(argv[++i]);
+      if (value < 1)
+        throw std::invalid_argument("Expected a positive value for " + arg);
+      if (arg == "--perft-depth")
+        perftDepth = value;
+      else if (arg == "--search-depth")
+        searchDepth = value;
+      else if (arg == "--repeat")
+        repeat = value;
+      else
+        throw std::invalid_argument("Unexpected argument " + arg);
+    }
+  } catch (const std::exception& e) {
+    fmt::print(stderr, "{}\nusage: dispatchbench [--perft-depth n] [--search-depth n] [--repeat n]\n", e.what());
+    return 1;
+  }
+
+  spdlog::set_level(spdlog::level::warn);
+  const std::vector<Board> positions = GetRandomPositions(20241030, {0, 4, 8, 12, 16, 20, 24, 28});
+  const EvalWeights weights;
+
+  auto perftDynamic = [&] {
+    uint64_t nodes = 0;
+    for (const Board& board : positions)
+      nodes += PerftDynamic(board, perftDepth);
+    return nodes;
+  };
+  auto perftStatic = [&] {
+    uint64_t nodes = 0;
+    for (const Board& board : positions) {
+      nodes += board.GetCurrentPlayer() == PlayerSymbol::X ? PerftStatic<PlayerSymbol::X>(board, perftDepth)
+                                                           : PerftStatic<PlayerSymbol::O>(board, perftDepth);
+    }
+    return nodes;
+  };
+  Report("perft", MeasureNodes(repeat, perftDynamic), MeasureNodes(repeat, perftStatic));
+
+  auto searchDynamic = [&] {
+    uint64_t nodes = 0;
+    for (const Board& board : positions)
+      NegamaxDynamic(board, weights, searchDepth, -s_infinity, s_infinity, nodes);
+    return nodes;
+  };
+  auto searchStatic = [&] {
+    uint64_t nodes = 0;
+    for (const Board& board : positions) {
+      if (board.GetCurrentPlayer() == PlayerSymbol::X)
+        NegamaxStatic<PlayerSymbol::X>(board, weights, searchDepth, -s_infinity, s_infinity, nodes);
+      else
+        NegamaxStatic<PlayerSymbol::O>(board, weights, searchDepth, -s_infinity, s_infinity, nodes);
+    }
+    return nodes;
+  };
+  Report("search", MeasureNodes(repeat, searchDynamic), MeasureNodes(repeat, searchStatic));
+  return 0;
+}
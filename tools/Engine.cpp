@@ -0,0 +1,37 @@
+// Runs the engine behind the text protocol of EngineProtocol.h on stdin
+// and stdout, for programs that drive it without the game window:
+//
+//   $ engine
+//   position startpos moves 40
+//   go movetime 100
+//   info depth 1 score 0 nodes 10 time 0 nps 1234567 pv 04
+//   ...
+//   bestmove 04
+//
+// Logs go to stderr, so stdout only carries the protocol.
+#include "pch.h"
+
+#include "EngineProtocol.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+
+int main() {
+  spdlog::set_default_logger(spdlog::stderr_color_mt("stderr"));
+  spdlog::set_level(spdlog::level::warn);
+
+  {
+    EngineProtocol protocol([](const std::string& line) {
+      // flushed on every line, the other side waits for it
+      std::cout << line << std::endl;
+    });
+    std::string line;
+    bool isQuit = false;
+    while (!isQuit && std::getline(std::cin, line))
+      isQuit = !protocol.HandleLine(line);
+    // the input may end right after a go, e.g. when piped from a file
+    if (!isQuit)
+      protocol.WaitForSearch();
+  }
+  // the players of the protocol are gone, with those replaced by setoption
+  AIPlayer::SaveScoreCaches();
+  return 0;
+}
@@ -0,0 +1,647 @@
+// Hosts many games at once over local TCP or a Unix socket, each
+// connection being a session with its own position and engine. Linux
+// only: a single epoll thread does all the I/O, the searches run on a
+// fixed pool of workers, so idle sessions cost a few hundred bytes and
+// no thread.
+//
+//   gameserver [--port n | --unix path] [--engine config] [--workers n] [--queue n]
+//              [--movetime ms] [--stats-interval s]
+//
+// Sessions send one command per line and get one line back for each:
+//
+//   position startpos|<notation> [moves <move>...]   ok
+//   play <move>                                       ok, plays a move for the side to move
+//   go [movetime ms]                                  bestmove <move> score <s> nodes <n> time <ms>
+//                                                     the engine move is played on the session board
+//   show                                              position <notation>
+//   quit
+//
+// Moves are written as board and cell, e.g. 40, and errors are answered
+// with error <reason>. go is answered with error busy when the queue of
+// searches is full, and with gameover <result> once the game is over.
+// The movetime of a go counts from reading it, the time it waits for a
+// worker included, so a search that starts late only gets what is left.
+// Commands sent during a search wait for it, up to 64 KB of them. The
+// latency of every go, from reading it to answering it, is reported every
+// --stats-interval seconds and on exit.
+#include "pch.h"
+
+#include "EngineProtocol.h"
+#include "LatencyHistogram.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+struct Options {
+  int port = 7878;
+  std::string unixPath;
+  AIConfig engine;
+  int workers = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+  std::size_t queueSize = 1024;
+  std::chrono::milliseconds moveTime{100};
+  int statsInterval = 10;
+};
+
+static void PrintUsage() {
+  fmt::print(
+      "usage: gameserver [--port n | --unix path] [--engine config] [--workers n] [--queue n]\n"
+      "                  [--movetime ms] [--stats-interval s]\n");
+}
+
+static Options ParseOptions(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc)
+      throw std::invalid_argument("Missing value for " + arg);
+    std::string value = argv[++i];
+
+    if (arg == "--port")
+      options.port = std::stoi(value);
+    else if (arg == "--unix")
+      options.unixPath = value;
+    else if (arg == "--engine")
+      options.engine = AIConfig::Parse(value);
+    else if (arg == "--workers")
+      options.workers = std::max(1, std::stoi(value));
+    else if (arg == "--queue")
+      options.queueSize = std::max(1ull, std::stoull(value));
+    else if (arg == "--movetime")
+      options.moveTime = std::chrono::milliseconds(std::max(1ll, std::stoll(value)));
+    else if (arg == "--stats-interval")
+      options.statsInterval = std::max(1, std::stoi(value));
+    else
+      throw std::invalid_argument("Unknown option " + arg);
+  }
+  return options;
+}
+
+/**
+ * A connection and its game. Only the reactor thread touches it, except
+ * player and stop while a worker searches for it.
+ */
+struct Session {
+  int fd = -1;
+  bool isClosed = false;
+  // bytes read but not handled yet, and bytes not written yet
+  std::string input;
+  std::string output;
+  bool isWaitingToWrite = false;
+
+  Board board;
+  // created by the first search, idle sessions stay small
+  std::unique_ptr<AIPlayer> player;
+  bool isSearching = false;
+  std::chrono::steady_clock::time_point requestStart;
+  // stops the search of a session whose connection is gone
+  std::atomic<bool> stop = false;
+};
+
+struct SearchJob {
+  std::shared_ptr<Session> session;
+  Board board;
+  SearchLimits limits;
+  // the move is due by then, limits.time is replaced by what is left of it
+  std::chrono::steady_clock::time_point deadline;
+};
+
+struct SearchDone {
+  std::shared_ptr<Session> session;
+  std::optional<SearchResult> result;
+};
+
+/**
+ * Fixed number of threads searching for the sessions. The queue is
+ * bounded, so a flood of requests is refused instead of piling up.
+ */
+class SearchPool {
+public:
+  SearchPool(int workers, std::size_t queueSize, const AIConfig& engine, int wakeFd)
+      : m_queueSize(queueSize), m_engine(engine), m_wakeFd(wakeFd) {
+    for (int i = 0; i < workers; i++)
+      m_workers.emplace_back([this] { Work(); });
+  }
+
+  ~SearchPool() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_isStopping = true;
+      for (SearchJob& job : m_jobs)
+        job.session->stop = true;
+    }
+    m_jobReady.notify_all();
+    for (std::thread& worker : m_workers)
+      worker.join();
+  }
+
+  // @return false if the queue is full
+  bool Submit(SearchJob job) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_jobs.size() >= m_queueSize)
+        return false;
+      m_jobs.push_back(std::move(job));
+    }
+    m_jobReady.notify_one();
+    return true;
+  }
+
+  // the searches finished since the last call, the reactor is woken up through wakeFd
+  std::vector<SearchDone> TakeDone() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return std::exchange(m_done, {});
+  }
+
+private:
+  void Work() {
+    while (true) {
+      SearchJob job;
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_jobReady.wait(lock, [&] { return m_isStopping || !m_jobs.empty(); });
+        if (m_isStopping)
+          return;
+        job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+      }
+
+      Session& session = *job.session;
+      if (!session.player)
+        session.player = std::make_unique<AIPlayer>(m_engine);
+      auto left = std::chrono::duration_cast<std::chrono::milliseconds>(job.deadline - std::chrono::steady_clock::now());
+      if (left.count() >= 1) {
+        job.limits.time = left;
+      } else {
+        // the job waited in the queue past its deadline, the first
+        // iteration always completes and takes next to no time
+        job.limits.depth = 0;
+      }
+      std::optional<SearchResult> result = session.player->Analyze(job.board, job.limits);
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_done.push_back({std::move(job.session), std::move(result)});
+      }
+      uint64_t one = 1;
+      if (write(m_wakeFd, &one, sizeof(one)) != sizeof(one))
+        SPDLOG_ERROR("Could not wake up the reactor: {}", std::strerror(errno));
+    }
+  }
+
+  const std::size_t m_queueSize;
+  const AIConfig m_engine;
+  const int m_wakeFd;
+  std::mutex m_mutex;
+  std::condition_variable m_jobReady;
+  std::deque<SearchJob> m_jobs;
+  std::vector<SearchDone> m_done;
+  bool m_isStopping = false;
+  std::vector<std::thread> m_workers;
+};
+
+class Server {
+public:
+  explicit Server(const Options& options)
+      : m_options(options) {}
+
+  ~Server() {
+    // the workers may still hold sessions, they are done with them once joined
+    m_pool.reset();
+    for (auto& [fd, session] : m_sessions)
+      close(fd);
+    for (int fd : {m_listenFd, m_wakeFd, m_signalFd, m_epollFd}) {
+      if (fd >= 0)
+        close(fd);
+    }
+    if (!m_options.unixPath.empty())
+      unlink(m_options.unixPath.c_str());
+  }
+
+  bool Start();
+  void Run();
+
+private:
+  bool Listen();
+  void Accept();
+  void Read(const std::shared_ptr<Session>& session);
+  void HandleLines(const std::shared_ptr<Session>& session);
+  void HandleLine(const std::shared_ptr<Session>& session, const std::string& line);
+  void Go(const std::shared_ptr<Session>& session, std::istringstream& args);
+  void FinishSearches();
+  void Reply(Session& session, const std::string& line);
+  void Flush(Session& session);
+  void Close(Session& session);
+  void WatchWrites(Session& session, bool isWatching);
+  void PrintStats();
+
+  // bytes of a session read but not handled yet
+  static constexpr std::size_t s_maxInput = 1 << 16;
+
+  const Options m_options;
+  int m_epollFd = -1;
+  int m_listenFd = -1;
+  // written by the workers when a search is done
+  int m_wakeFd = -1;
+  // SIGINT and SIGTERM, to print the statistics before leaving
+  int m_signalFd = -1;
+  std::unique_ptr<SearchPool> m_pool;
+  std::unordered_map<int, std::shared_ptr<Session>> m_sessions;
+
+  LatencyHistogram m_latency;
+  LatencyHistogram m_totalLatency;
+  uint64_t m_busyReplies = 0;
+  std::chrono::steady_clock::time_point m_lastStats;
+};
+
+bool Server::Start() {
+  // blocked before the workers start so they inherit it, only the signalfd sees them
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  sigprocmask(SIG_BLOCK, &signals, nullptr);
+  // a client leaving mid write must not kill the server
+  signal(SIGPIPE, SIG_IGN);
+
+  m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+  m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  m_signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (m_epollFd < 0 || m_wakeFd < 0 || m_signalFd < 0) {
+    SPDLOG_ERROR("Could not create the event loop: {}", std::strerror(errno));
+    return false;
+  }
+  if (!Listen())
+    return false;
+
+  for (int fd : {m_listenFd, m_wakeFd, m_signalFd}) {
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event);
+  }
+  m_pool = std::make_unique<SearchPool>(m_options.workers, m_options.queueSize, m_options.engine, m_wakeFd);
+  m_lastStats = std::chrono::steady_clock::now();
+  return true;
+}
+
+bool Server::Listen() {
+  if (!m_options.unixPath.empty()) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (m_options.unixPath.size() >= sizeof(address.sun_path)) {
+      SPDLOG_ERROR("The socket path {} is too long", m_options.unixPath);
+      return false;
+    }
+    std::strcpy(address.sun_path, m_options.unixPath.c_str());
+    unlink(address.sun_path);
+    m_listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_listenFd < 0 || bind(m_listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        listen(m_listenFd, SOMAXCONN) < 0) {
+      SPDLOG_ERROR("Could not listen on {}: {}", m_options.unixPath, std::strerror(errno));
+      return false;
+    }
+    fmt::print("Listening on {}\n", m_options.unixPath);
+    return true;
+  }
+
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  // local games only, nothing here is meant to face a network
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(static_cast<uint16_t>(m_options.port));
+  m_listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  int reuse = 1;
+  if (m_listenFd < 0 || setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0 ||
+      bind(m_listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+      listen(m_listenFd, SOMAXCONN) < 0) {
+    SPDLOG_ERROR("Could not listen on port {}: {}", m_options.port, std::strerror(errno));
+    return false;
+  }
+  fmt::print("Listening on 127.0.0.1:{}\n", m_options.port);
+  return true;
+}
+
+void Server::Run() {
+  std::array<epoll_event, 256> events;
+  const auto interval = std::chrono::seconds(m_options.statsInterval);
+  while (true) {
+    auto untilStats = m_lastStats + interval - std::chrono::steady_clock::now();
+    int timeout = static_cast<int>(std::max<int64_t>(
+        0, std::chrono::duration_cast<std::chrono::milliseconds>(untilStats).count() + 1));
+    int count = epoll_wait(m_epollFd, events.data(), static_cast<int>(events.size()), timeout);
+    if (count < 0 && errno != EINTR) {
+      SPDLOG_ERROR("epoll_wait failed: {}", std::strerror(errno));
+      break;
+    }
+
+    for (int i = 0; i < count; i++) {
+      int fd = events[i].data.fd;
+      if (fd == m_listenFd) {
+        Accept();
+      } else if (fd == m_wakeFd) {
+        uint64_t wakeups;
+        while (read(m_wakeFd, &wakeups, sizeof(wakeups)) > 0) {
+        }
+        FinishSearches();
+      } else if (fd == m_signalFd) {
+        fmt::print("Stopping\n");
+        PrintStats();
+        return;
+      } else {
+        auto it = m_sessions.find(fd);
+        if (it == m_sessions.end())
+          continue;
+        // keeps the session alive until the end of the iteration
+        std::shared_ptr<Session> session = it->second;
+        if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+          Close(*session);
+          continue;
+        }
+        if (events[i].events & EPOLLOUT)
+          Flush(*session);
+        if (!session->isClosed && (events[i].events & EPOLLIN))
+          Read(session);
+      }
+    }
+
+    if (std::chrono::steady_clock::now() - m_lastStats >= interval)
+      PrintStats();
+  }
+}
+
+void Server::Accept() {
+  while (true) {
+    int fd = accept4(m_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        SPDLOG_ERROR("accept failed: {}", std::strerror(errno));
+      if (errno != EINTR)
+        return;
+      continue;
+    }
+    // the replies are single short lines, they should not wait for more
+    int noDelay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+    auto session = std::make_shared<Session>();
+    session->fd = fd;
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+      SPDLOG_ERROR("Could not watch a connection: {}", std::strerror(errno));
+      close(fd);
+      continue;
+    }
+    m_sessions.emplace(fd, std::move(session));
+  }
+}
+
+void Server::Read(const std::shared_ptr<Session>& session) {
+  char buffer[4096];
+  // the rest stays in the socket until the lines read so far are handled
+  while (session->input.size() <= s_maxInput) {
+    ssize_t size = read(session->fd, buffer, sizeof(buffer));
+    if (size > 0) {
+      session->input.append(buffer, static_cast<std::size_t>(size));
+      continue;
+    }
+    if (size < 0 && errno == EINTR)
+      continue;
+    if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      break;
+    // end of the connection or an error
+    Close(*session);
+    return;
+  }
+  HandleLines(session);
+  // a line this long is not a command, and a client sending this much during
+  // a search does not wait for the answers, either would only fill the memory
+  if (!session->isClosed && session->input.size() > s_maxInput) {
+    Reply(*session, "error too much input");
+    Flush(*session);
+    Close(*session);
+  }
+}
+
+void Server::HandleLines(const std::shared_ptr<Session>& session) {
+  std::size_t begin = 0;
+  std::size_t end;
+  // lines after a go wait for its answer, so they see the position after the engine move
+  while (!session->isClosed && !session->isSearching && (end = session->input.find('\n', begin)) != std::string::npos) {
+    std::string line = session->input.substr(begin, end - begin);
+    begin = end + 1;
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+    HandleLine(session, line);
+  }
+  if (!session->isClosed) {
+    session->input.erase(0, begin);
+    Flush(*session);
+  }
+}
+
+// whether later has every piece of earlier, as the later positions of a game do
+static bool IsContinuation(const Board& earlier, const Board& later) {
+  for (PlayerSymbol player : {PlayerSymbol::X, PlayerSymbol::O}) {
+    for (int boardPosition = 0; boardPosition < 9; boardPosition++) {
+      uint16_t cells = earlier.GetCellMask(player, boardPosition);
+      if ((later.GetCellMask(player, boardPosition) & cells) != cells)
+        return false;
+    }
+  }
+  return true;
+}
+
+void Server::HandleLine(const std::shared_ptr<Session>& session, const std::string& line) {
+  std::istringstream args(line);
+  std::string command;
+  if (!(args >> command))
+    return;
+
+  try {
+    if (command == "quit") {
+      Flush(*session);
+      Close(*session);
+    } else if (command == "position") {
+      std::string token;
+      std::string notation;
+      while (args >> token && token != "moves") {
+        if (!notation.empty())
+          notation += ' ';
+        notation += token;
+      }
+      Board board = notation == "startpos" ? Board() : Board::FromNotation(notation);
+      while (args >> token) {
+        Move move = EngineProtocol::ParseMove(token);
+        if (board.IsGameOver() || !board.IsMoveLegal(move))
+          throw std::invalid_argument("illegal move " + token);
+        board.Play(move);
+      }
+      // the scores the engine cached for another game would only pile up
+      if (session->player && !IsContinuation(session->board, board))
+        session->player->Reset();
+      session->board = board;
+      Reply(*session, "ok");
+    } else if (command == "play") {
+      std::string token;
+      args >> token;
+      Move move = EngineProtocol::ParseMove(token);
+      if (session->board.IsGameOver() || !session->board.IsMoveLegal(move))
+        throw std::invalid_argument("illegal move " + token);
+      session->board.Play(move);
+      Reply(*session, "ok");
+    } else if (command == "go") {
+      Go(session, args);
+    } else if (command == "show") {
+      Reply(*session, "position " + session->board.ToNotation());
+    } else {
+      throw std::invalid_argument("unknown command " + command);
+    }
+  } catch (const std::exception& e) {
+    Reply(*session, fmt::format("error {}", e.what()));
+  }
+}
+
+void Server::Go(const std::shared_ptr<Session>& session, std::istringstream& args) {
+  SearchLimits limits;
+  // the engine plays as well as it can within the deadline
+  limits.depth = 80;
+  limits.time = m_options.moveTime;
+  std::string token;
+  while (args >> token) {
+    std::string value;
+    if (token != "movetime" || !(args >> value))
+      throw std::invalid_argument("expected go [movetime ms]");
+    limits.time = std::chrono::milliseconds(std::max(1ll, std::stoll(value)));
+  }
+  if (session->board.IsGameOver()) {
+    Reply(*session, fmt::format("gameover {}", session->board.GetTopGameStatus()));
+    return;
+  }
+
+  limits.stop = &session->stop;
+  session->requestStart = std::chrono::steady_clock::now();
+  if (!m_pool->Submit({session, session->board, limits, session->requestStart + limits.time})) {
+    m_busyReplies++;
+    Reply(*session, "error busy");
+    return;
+  }
+  session->isSearching = true;
+}
+
+void Server::FinishSearches() {
+  const auto now = std::chrono::steady_clock::now();
+  for (SearchDone& done : m_pool->TakeDone()) {
+    Session& session = *done.session;
+    session.isSearching = false;
+    if (session.isClosed)
+      continue;
+
+    m_latency.Record(now - session.requestStart);
+    if (done.result) {
+      const SearchResult& result = *done.result;
+      session.board.Play(result.move);
+      Reply(session, fmt::format("bestmove {} score {} nodes {} time {}", EngineProtocol::FormatMove(result.move),
+                                 result.score, result.stats.nodes,
+                                 std::chrono::duration_cast<std::chrono::milliseconds>(result.stats.elapsed).count()));
+    } else {
+      Reply(session, fmt::format("gameover {}", session.board.GetTopGameStatus()));
+    }
+    HandleLines(done.session);
+  }
+}
+
+void Server::Reply(Session& session, const std::string& line) {
+  session.output += line;
+  session.output += '\n';
+}
+
+void Server::Flush(Session& session) {
+  while (!session.output.empty()) {
+    ssize_t size = write(session.fd, session.output.data(), session.output.size());
+    if (size > 0) {
+      session.output.erase(0, static_cast<std::size_t>(size));
+      continue;
+    }
+    if (size < 0 && errno == EINTR)
+      continue;
+    if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      // the rest is written once the socket has room again
+      WatchWrites(session, true);
+      return;
+    }
+    Close(session);
+    return;
+  }
+  WatchWrites(session, false);
+}
+
+void Server::WatchWrites(Session& session, bool isWatching) {
+  if (session.isWaitingToWrite == isWatching)
+    return;
+  session.isWaitingToWrite = isWatching;
+  epoll_event event = {};
+  event.events = isWatching ? EPOLLIN | EPOLLOUT : EPOLLIN;
+  event.data.fd = session.fd;
+  epoll_ctl(m_epollFd, EPOLL_CTL_MOD, session.fd, &event);
+}
+
+void Server::Close(Session& session) {
+  if (session.isClosed)
+    return;
+  session.isClosed = true;
+  // a search still running for it is of no use anymore
+  session.stop = true;
+  epoll_ctl(m_epollFd, EPOLL_CTL_DEL, session.fd, nullptr);
+  close(session.fd);
+  // the workers keep their own reference until they are done
+  m_sessions.erase(session.fd);
+}
+
+void Server::PrintStats() {
+  m_totalLatency.Merge(m_latency);
+  fmt::print("sessions={} busy={} last {}s: {}\n", m_sessions.size(), m_busyReplies, m_options.statsInterval,
+             m_latency);
+  fmt::print("  total: {}\n", m_totalLatency);
+  std::fflush(stdout);
+  m_latency.Clear();
+  m_lastStats = std::chrono::steady_clock::now();
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  try {
+    options = ParseOptions(argc, argv);
+  } catch (const std::exception& e) {
+    fmt::print(stderr, "{}\n", e.what());
+    PrintUsage();
+    return 1;
+  }
+  spdlog::set_level(spdlog::level::warn);
+
+  // every session is a file descriptor, the default limit is often 1024
+  rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+
+  {
+    Server server(options);
+    if (!server.Start())
+      return 1;
+    server.Run();
+  }
+  // once the sessions and their players are gone
+  AIPlayer::SaveScoreCaches();
+  return 0;
+}
@@ -0,0 +1,383 @@
+// Load generator for gameserver on the same machine, Linux only. Opens
+// idle sessions that only hold a connection, and active ones that play
+// engine against engine as fast as the server answers:
+//
+//   loadgen [--port n | --unix path] [--idle n] [--clients n] [--duration s] [--movetime ms]
+//
+// The active sessions are all driven by one epoll thread, like the server
+// drives its side. Reports the moves per second and the latency of every
+// go as seen by the clients, then checks that every idle session still
+// answers.
+#include "pch.h"
+
+#include "LatencyHistogram.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+struct Options {
+  int port = 7878;
+  std::string unixPath;
+  int idle = 1000;
+  int clients = 32;
+  int duration = 10;
+  int moveTime = 10;
+};
+
+static void PrintUsage() {
+  fmt::print("usage: loadgen [--port n | --unix path] [--idle n] [--clients n] [--duration s] [--movetime ms]\n");
+}
+
+static Options ParseOptions(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc)
+      throw std::invalid_argument("Missing value for " + arg);
+    std::string value = argv[++i];
+
+    if (arg == "--port")
+      options.port = std::stoi(value);
+    else if (arg == "--unix")
+      options.unixPath = value;
+    else if (arg == "--idle")
+      options.idle = std::max(0, std::stoi(value));
+    else if (arg == "--clients")
+      options.clients = std::max(1, std::stoi(value));
+    else if (arg == "--duration")
+      options.duration = std::max(1, std::stoi(value));
+    else if (arg == "--movetime")
+      options.moveTime = std::max(1, std::stoi(value));
+    else
+      throw std::invalid_argument("Unknown option " + arg);
+  }
+  return options;
+}
+
+/**
+ * Connection to the server exchanging lines, blocking unless made non
+ * blocking for the epoll loop
+ */
+class Connection {
+public:
+  ~Connection() {
+    if (m_fd >= 0)
+      close(m_fd);
+  }
+
+  // @return false if the server cannot be reached
+  bool Open(const Options& options) {
+    if (!options.unixPath.empty()) {
+      sockaddr_un address = {};
+      address.sun_family = AF_UNIX;
+      std::strncpy(address.sun_path, options.unixPath.c_str(), sizeof(address.sun_path) - 1);
+      m_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+      return m_fd >= 0 && connect(m_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    }
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(static_cast<uint16_t>(options.port));
+    m_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m_fd < 0 || connect(m_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+      return false;
+    int noDelay = 1;
+    setsockopt(m_fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    return true;
+  }
+
+  int GetFd() const { return m_fd; }
+
+  bool SetNonBlocking() {
+    int flags = fcntl(m_fd, F_GETFL);
+    return flags >= 0 && fcntl(m_fd, F_SETFL, flags | O_NONBLOCK) == 0;
+  }
+
+  // a non blocking connection fails when the socket buffer is full
+  bool Send(const std::string& line) {
+    std::string data = line + '\n';
+    for (std::size_t sent = 0; sent < data.size();) {
+      ssize_t size = write(m_fd, data.data() + sent, data.size() - sent);
+      if (size <= 0 && errno != EINTR)
+        return false;
+      sent += static_cast<std::size_t>(std::max<ssize_t>(size, 0));
+    }
+    return true;
+  }
+
+  // @return the next line, or nullopt if the connection is closed
+  std::optional<std::string> Receive() {
+    while (true) {
+      if (std::optional<std::string> line = TakeLine())
+        return line;
+      char buffer[4096];
+      ssize_t size = read(m_fd, buffer, sizeof(buffer));
+      if (size < 0 && errno == EINTR)
+        continue;
+      if (size <= 0)
+        return std::nullopt;
+      m_input.append(buffer, static_cast<std::size_t>(size));
+    }
+  }
+
+  /**
+   * Reads what a non blocking connection has received so far
+   *
+   * @return false if the connection is closed
+   */
+  bool ReadAvailable() {
+    while (true) {
+      char buffer[4096];
+      ssize_t size = read(m_fd, buffer, sizeof(buffer));
+      if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        return true;
+      if (size < 0 && errno == EINTR)
+        continue;
+      if (size <= 0)
+        return false;
+      m_input.append(buffer, static_cast<std::size_t>(size));
+    }
+  }
+
+  // @return the next line already received, or nullopt if there is none yet
+  std::optional<std::string> TakeLine() {
+    std::size_t end = m_input.find('\n');
+    if (end == std::string::npos)
+      return std::nullopt;
+    std::string line = m_input.substr(0, end);
+    m_input.erase(0, end + 1);
+    return line;
+  }
+
+private:
+  int m_fd = -1;
+  std::string m_input;
+};
+
+struct ClientStats {
+  LatencyHistogram latency;
+  uint64_t moves = 0;
+  uint64_t games = 0;
+  uint64_t busy = 0;
+  uint64_t errors = 0;
+};
+
+/**
+ * Active sessions playing games until a deadline, the server engine playing
+ * both sides. A single thread waits on all of them with epoll.
+ *
+ * A client has one command in flight at most, so its line always fits in
+ * the socket buffer and sending never has to wait.
+ */
+class Clients {
+public:
+  Clients(const Options& options, std::chrono::steady_clock::time_point deadline);
+  ~Clients();
+  Clients(const Clients&) = delete;
+  Clients& operator=(const Clients&) = delete;
+
+  // @return the stats of every client together
+  ClientStats Run();
+
+private:
+  struct Client {
+    Connection connection;
+    bool isNewGame = true;
+    bool isDone = false;
+    std::chrono::steady_clock::time_point goStart;
+    // set while it waits for the server queue to make room
+    std::optional<std::chrono::steady_clock::time_point> retryAt;
+  };
+
+  // sends the next command, or quit once the deadline has passed
+  void SendNext(Client& client);
+  void HandleLine(Client& client, const std::string& line);
+  void Finish(Client& client, bool isError);
+  // @return milliseconds until the next retry is due, -1 if none is
+  int GetTimeout() const;
+
+  const Options& m_options;
+  const std::chrono::steady_clock::time_point m_deadline;
+  const std::string m_go;
+  int m_epollFd = -1;
+  std::vector<std::unique_ptr<Client>> m_clients;
+  std::size_t m_running = 0;
+  ClientStats m_stats;
+};
+
+Clients::Clients(const Options& options, std::chrono::steady_clock::time_point deadline)
+    : m_options(options), m_deadline(deadline), m_go(fmt::format("go movetime {}", options.moveTime)) {
+  m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+  if (m_epollFd < 0) {
+    SPDLOG_CRITICAL("Could not create the epoll instance: {}", std::strerror(errno));
+    abort();
+  }
+}
+
+Clients::~Clients() {
+  close(m_epollFd);
+}
+
+ClientStats Clients::Run() {
+  for (int i = 0; i < m_options.clients; i++) {
+    auto client = std::make_unique<Client>();
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u32 = static_cast<uint32_t>(m_clients.size());
+    if (!client->connection.Open(m_options) || !client->connection.SetNonBlocking() ||
+        epoll_ctl(m_epollFd, EPOLL_CTL_ADD, client->connection.GetFd(), &event) < 0) {
+      m_stats.errors++;
+      continue;
+    }
+    m_clients.push_back(std::move(client));
+    m_running++;
+    SendNext(*m_clients.back());
+  }
+
+  std::array<epoll_event, 256> events;
+  while (m_running > 0) {
+    int count = epoll_wait(m_epollFd, events.data(), static_cast<int>(events.size()), GetTimeout());
+    if (count < 0 && errno != EINTR) {
+      SPDLOG_ERROR("epoll_wait failed: {}", std::strerror(errno));
+      break;
+    }
+    for (int i = 0; i < count; i++) {
+      Client& client = *m_clients[events[i].data.u32];
+      if (client.isDone)
+        continue;
+      if (!client.connection.ReadAvailable()) {
+        Finish(client, true);
+        continue;
+      }
+      while (!client.isDone) {
+        std::optional<std::string> line = client.connection.TakeLine();
+        if (!line)
+          break;
+        HandleLine(client, *line);
+      }
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    for (const std::unique_ptr<Client>& client : m_clients) {
+      if (!client->isDone && client->retryAt && *client->retryAt <= now) {
+        client->retryAt.reset();
+        SendNext(*client);
+      }
+    }
+  }
+  return m_stats;
+}
+
+void Clients::SendNext(Client& client) {
+  if (std::chrono::steady_clock::now() >= m_deadline) {
+    client.connection.Send("quit");
+    Finish(client, false);
+    return;
+  }
+  client.goStart = std::chrono::steady_clock::now();
+  if (!client.connection.Send(client.isNewGame ? "position startpos" : m_go))
+    Finish(client, true);
+}
+
+void Clients::HandleLine(Client& client, const std::string& line) {
+  if (client.isNewGame) {
+    if (line != "ok") {
+      SPDLOG_ERROR("Unexpected reply: {}", line);
+      Finish(client, true);
+      return;
+    }
+    client.isNewGame = false;
+  } else if (line.starts_with("bestmove")) {
+    m_stats.latency.Record(std::chrono::steady_clock::now() - client.goStart);
+    m_stats.moves++;
+  } else if (line.starts_with("gameover")) {
+    m_stats.games++;
+    client.isNewGame = true;
+  } else if (line == "error busy") {
+    // the server queue is full, let it catch up
+    m_stats.busy++;
+    client.retryAt = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_options.moveTime);
+    return;
+  } else {
+    SPDLOG_ERROR("Unexpected reply: {}", line);
+    Finish(client, true);
+    return;
+  }
+  SendNext(client);
+}
+
+void Clients::Finish(Client& client, bool isError) {
+  if (isError)
+    m_stats.errors++;
+  client.isDone = true;
+  m_running--;
+  epoll_ctl(m_epollFd, EPOLL_CTL_DEL, client.connection.GetFd(), nullptr);
+}
+
+int Clients::GetTimeout() const {
+  std::optional<std::chrono::steady_clock::time_point> next;
+  for (const std::unique_ptr<Client>& client : m_clients) {
+    if (!client->isDone && client->retryAt && (!next || *client->retryAt < *next))
+      next = client->retryAt;
+  }
+  if (!next)
+    return -1;
+  auto left = std::chrono::ceil<std::chrono::milliseconds>(*next - std::chrono::steady_clock::now());
+  return static_cast<int>(std::max<int64_t>(left.count(), 0));
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  try {
+    options = ParseOptions(argc, argv);
+  } catch (const std::exception& e) {
+    fmt::print(stderr, "{}\n", e.what());
+    PrintUsage();
+    return 1;
+  }
+  spdlog::set_level(spdlog::level::warn);
+  signal(SIGPIPE, SIG_IGN);
+
+  // every session is a file descriptor, the default limit is often 1024
+  rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+
+  std::vector<std::unique_ptr<Connection>> idle;
+  for (int i = 0; i < options.idle; i++) {
+    auto connection = std::make_unique<Connection>();
+    if (!connection->Open(options)) {
+      fmt::print(stderr, "Could only open {} idle sessions: {}\n", i, std::strerror(errno));
+      break;
+    }
+    idle.push_back(std::move(connection));
+  }
+  fmt::print("Opened {} idle sessions\n", idle.size());
+
+  const auto start = std::chrono::steady_clock::now();
+  const auto deadline = start + std::chrono::seconds(options.duration);
+  ClientStats total = Clients(options, deadline).Run();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  fmt::print("{} clients: moves={} games={} moves_per_s={:.1f} busy={} errors={}\n", options.clients, total.moves,
+             total.games, total.moves / seconds, total.busy, total.errors);
+  fmt::print("go latency: {}\n", total.latency);
+
+  std::size_t alive = 0;
+  for (const std::unique_ptr<Connection>& connection : idle) {
+    if (connection->Send("show") && connection->Receive().value_or("").starts_with("position"))
+      alive++;
+  }
+  fmt::print("{} of {} idle sessions still answer\n", alive, idle.size());
+  return total.errors == 0 && alive == idle.size() ? 0 : 1;
+}
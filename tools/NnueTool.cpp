@@ -0,0 +1,180 @@
+// Utilities for the learned evaluation (players/Nnue.h)
+//
+//   nnuetool random <out> [seed]       writes a randomly initialized network
+//   nnuetool bench <network> [games]   measures incremental updates + evaluations per second
+//   nnuetool batch <network> [threads] measures batched evaluations against one at a time
+#include "pch.h"
+
+#include "players/EvalBatcher.h"
+
+static void PrintUsage() {
+  fmt::print(
+      "usage:\n"
+      "  nnuetool random <out> [seed]\n"
+      "  nnuetool bench <network> [games]\n"
+      "  nnuetool batch <network> [threads]\n");
+}
+
+static int Random(const std::string& out, uint32_t seed) {
+  if (!Nnue::Random(seed)->Save(out)) {
+    fmt::print(stderr, "Could not write {}\n", out);
+    return 1;
+  }
+  fmt::print("Wrote a random network to {}\n", out);
+  return 0;
+}
+
+/**
+ * Replays random games and evaluates every child of every position
+ * reached, the way the search does at its last ply
+ */
+static int Bench(const std::string& path, int games) {
+  std::shared_ptr<const Nnue> nnue = Nnue::Load(path);
+  if (!nnue)
+    return 1;
+
+  // generate the positions up front so only the network is timed
+  std::mt19937 rng(1);
+  std::vector<std::pair<Board, std::vector<std::pair<Move, Board>>>> positions;
+  for (int game = 0; game < games; game++) {
+    Board board;
+    while (!board.IsGameOver()) {
+      std::vector<Move> moves = board.GetLegalMoves();
+      std::vector<std::pair<Move, Board>> children;
+      for (const Move& move : moves) {
+        Board child = board;
+        child.Play(move);
+        children.push_back({move, child});
+      }
+      positions.push_back({board, children});
+      board.Play(moves[rng() % moves.size()]);
+    }
+  }
+
+  uint64_t evaluations = 0;
+  int64_t checksum = 0;
+  Nnue::Accumulator acc;
+  Nnue::Accumulator childAcc;
+  const auto start = std::chrono::steady_clock::now();
+  for (const auto& [board, children] : positions) {
+    nnue->Refresh(board, acc);
+    for (const auto& [move, child] : children) {
+      nnue->Update(board, move, child, acc, childAcc);
+      checksum += nnue->Evaluate(childAcc);
+      evaluations++;
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  fmt::print("{} evaluations in {:.3f}s: {:.0f} evaluations/s (checksum {})\n",
+             evaluations, seconds, evaluations / seconds, checksum);
+  return 0;
+}
+
+// accumulators of the positions of random games, computed up front
+static std::vector<Nnue::Accumulator> MakeAccumulators(const Nnue& nnue, int games) {
+  std::mt19937 rng(1);
+  std::vector<Nnue::Accumulator> accs;
+  for (int game = 0; game < games; game++) {
+    Board board;
+    while (!board.IsGameOver()) {
+      nnue.Refresh(board, accs.emplace_back());
+      std::vector<Move> moves = board.GetLegalMoves();
+      board.Play(moves[rng() % moves.size()]);
+    }
+  }
+  return accs;
+}
+
+/**
+ * Evaluations per second of the network one position at a time, with
+ * Nnue::EvaluateBatch, and through an EvalBatcher fed by several threads
+ */
+static int BatchBench(const std::string& path, int threads) {
+  std::shared_ptr<const Nnue> nnue = Nnue::Load(path);
+  if (!nnue)
+    return 1;
+  const std::vector<Nnue::Accumulator> accs = MakeAccumulators(*nnue, 500);
+  constexpr int s_repeat = 20;
+  const uint64_t evaluations = static_cast<uint64_t>(accs.size()) * s_repeat;
+
+  int64_t expected = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < s_repeat; r++) {
+    for (const Nnue::Accumulator& acc : accs)
+      expected += nnue->Evaluate(acc);
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  fmt::print("one at a time:       {:>12.0f} evaluations/s\n", evaluations / seconds);
+
+  std::vector<const Nnue::Accumulator*> pointers;
+  for (const Nnue::Accumulator& acc : accs)
+    pointers.push_back(&acc);
+  std::vector<int32_t> scores(accs.size());
+  for (std::size_t batchSize : {4, 16, 64, 256}) {
+    int64_t checksum = 0;
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < s_repeat; r++) {
+      for (std::size_t i = 0; i < accs.size(); i += batchSize) {
+        std::size_t size = std::min(batchSize, accs.size() - i);
+        nnue->EvaluateBatch(&pointers[i], size, &scores[i]);
+      }
+      for (int32_t score : scores)
+        checksum += score;
+    }
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    fmt::print("batch of {:<4}        {:>12.0f} evaluations/s{}\n", batchSize, evaluations / seconds,
+               checksum == expected ? "" : " (wrong scores)");
+  }
+
+  // every thread evaluates its share of the positions, as concurrent searches would
+  auto runThreads = [&](const std::function<int32_t(const Nnue::Accumulator&)>& evaluate) {
+    std::atomic<int64_t> checksum = 0;
+    std::vector<std::thread> workers;
+    const auto threadStart = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; t++) {
+      workers.emplace_back([&, t] {
+        int64_t sum = 0;
+        for (int r = 0; r < s_repeat; r++) {
+          for (std::size_t i = t; i < accs.size(); i += threads)
+            sum += evaluate(accs[i]);
+        }
+        checksum += sum;
+      });
+    }
+    for (std::thread& worker : workers)
+      worker.join();
+    double threadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - threadStart).count();
+    return std::pair(evaluations / threadSeconds, checksum == expected);
+  };
+  auto [direct, isDirectRight] = runThreads([&](const Nnue::Accumulator& acc) { return nnue->Evaluate(acc); });
+  fmt::print("{} threads directly: {:>12.0f} evaluations/s{}\n", threads, direct, isDirectRight ? "" : " (wrong scores)");
+  for (std::size_t batchSize = 2; batchSize <= static_cast<std::size_t>(threads); batchSize *= 2) {
+    EvalBatcher batcher(nnue, batchSize, std::chrono::microseconds(200));
+    auto [batched, isRight] = runThreads([&](const Nnue::Accumulator& acc) { return batcher.Evaluate(acc); });
+    fmt::print("{} threads, batches of {}: {:>12.0f} evaluations/s, {} of {} batches partial{}\n", threads,
+               batchSize, batched, batcher.GetPartialBatchCount(), batcher.GetBatchCount(),
+               isRight ? "" : " (wrong scores)");
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    PrintUsage();
+    return 1;
+  }
+  std::string command = argv[1];
+  try {
+    if (command == "random")
+      return Random(argv[2], argc > 3 ? static_cast<uint32_t>(std::stoul(argv[3])) : 1);
+    if (command == "bench")
+      return Bench(argv[2], argc > 3 ? std::stoi(argv[3]) : 200);
+    if (command == "batch")
+      return BatchBench(argv[2], std::max(1, argc > 3 ? std::stoi(argv[3]) : 8));
+  } catch (const std::exception& e) {
+    fmt::print(stderr, "{}\n", e.what());
+  }
+  PrintUsage();
+  return 1;
+}
@@ -0,0 +1,138 @@
+// Measures how fast positions are read and written in the one line
+// notation (Board::FromNotation), in the packed binary form
+// (Board::Pack) and with the original 81 character board strings,
+// and checks that every position survives the round trips.
+//
+//   notationbench [--positions n] [--repeat n]
+#include "pch.h"
+
+#include "BenchUtils.h"
+#include "Board.h"
+
+// every position of pseudo random games until there are enough of them
+static std::vector<Board> GetPositions(std::size_t count) {
+  std::vector<Board> positions;
+  positions.reserve(count);
+  std::mt19937 rng(20241112);
+  while (positions.size() < count) {
+    Board board;
+    while (!board.IsGameOver() && positions.size() < count) {
+      PlayRandomMove(board, rng);
+      positions.push_back(board);
+    }
+  }
+  return positions;
+}
+
+// the cells row by row, as read by Board(std::string_view, const Move&)
+static std::string ToBoardString(const Board& board) {
+  std::string str;
+  for (int row = 0; row < 9; row++) {
+    for (int col = 0; col < 9; col++) {
+      Piece piece = board.GetPieceAtRowCol(row, col);
+      str += piece == Piece::X ? 'x' : piece == Piece::O ? 'o'
+                                                         : '.';
+    }
+  }
+  return str;
+}
+
+static void Report(const char* name, std::size_t positions, std::size_t bytes, double seconds) {
+  fmt::print("{:<14} positions_per_s={:.2f}M mb_per_s={:.1f} ns_per_position={:.1f}\n", name,
+             positions / seconds / 1e6, bytes / seconds / 1e6, seconds * 1e9 / positions);
+}
+
+static void Fail(const std::string& message) {
+  fmt::print(stderr, "{}\n", message);
+  std::exit(1);
+}
+
+int main(int argc, char** argv) {
+  std::size_t count = 1000000;
+  int repeat = 3;
+  try {
+    for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+      if (i + 1 >= argc)
+        throw std::invalid_argument("Missing value for " + arg);
+      int value = std::stoi(argv[++i]);
+      if (value < 1)
+        throw std::invalid_argument("Expected a positive value for " + arg);
+      if (arg == "--positions")
+        count = static_cast<std::size_t>(value);
+      else if (arg == "--repeat")
+        repeat = value;
+      else
+        throw std::invalid_argument("Unexpected argument " + arg);
+    }
+  } catch (const std::exception& e) {
+    fmt::print(stderr, "{}\nusage: notationbench [--positions n] [--repeat n]\n", e.what());
+    return 1;
+  }
+
+  spdlog::set_level(spdlog::level::warn);
+  const std::vector<Board> positions = GetPositions(count);
+
+  // all the notations one per line in a single buffer, as they would be read from a file
+  std::string text;
+  text.reserve(positions.size() * (Board::s_maxNotationSize + 1));
+  std::vector<std::string_view> lines;
+  lines.reserve(positions.size());
+  double writeTime = Measure(repeat, [&] {
+    text.clear();
+    char buffer[Board::s_maxNotationSize];
+    for (const Board& board : positions) {
+      text.append(buffer, board.WriteNotation(buffer));
+      text += '\n';
+    }
+  });
+  for (std::size_t begin = 0, end; begin < text.size(); begin = end + 1) {
+    end = text.find('\n', begin);
+    lines.emplace_back(text.data() + begin, end - begin);
+  }
+  Report("write_notation", positions.size(), text.size(), writeTime);
+
+  uint64_t checksum = 0;
+  double readTime = Measure(repeat, [&] {
+    for (std::string_view line : lines)
+      checksum += Board::FromNotation(line).GetKey();
+  });
+  Report("read_notation", positions.size(), text.size(), readTime);
+
+  std::vector<PackedBoard> packed(positions.size());
+  double packTime = Measure(repeat, [&] {
+    for (std::size_t i = 0; i < positions.size(); i++)
+      packed[i] = positions[i].Pack();
+  });
+  const std::size_t packedBytes = packed.size() * sizeof(PackedBoard);
+  Report("pack", positions.size(), packedBytes, packTime);
+
+  double unpackTime = Measure(repeat, [&] {
+    for (const PackedBoard& p : packed)
+      checksum += Board::Unpack(p).GetKey();
+  });
+  Report("unpack", positions.size(), packedBytes, unpackTime);
+
+  std::vector<std::string> boardStrings;
+  boardStrings.reserve(positions.size());
+  for (const Board& board : positions)
+    boardStrings.push_back(ToBoardString(board));
+  double stringTime = Measure(repeat, [&] {
+    for (std::size_t i = 0; i < positions.size(); i++)
+      checksum += Board(boardStrings[i], *positions[i].GetLastMove()).GetKey();
+  });
+  Report("board_string", positions.size(), positions.size() * 81, stringTime);
+
+  // the notation keeps everything but the exact last move, the packed form everything
+  for (std::size_t i = 0; i < positions.size(); i++) {
+    const Board& board = positions[i];
+    Board fromNotation = Board::FromNotation(lines[i]);
+    if (fromNotation.GetKey() != board.GetKey() || fromNotation.ToNotation() != lines[i] ||
+        fromNotation.GetLegalMoves() != board.GetLegalMoves())
+      Fail(fmt::format("{} does not read back as the position it was written from", lines[i]));
+    if (!(Board::Unpack(packed[i]) == board))
+      Fail(fmt::format("{} does not unpack as the position it was packed from", lines[i]));
+  }
+  fmt::print("round trips ok, checksum={:x}\n", checksum);
+  return 0;
+}
@@ -0,0 +1,99 @@
+// Reads game record files (GameRecord.h), e.g. those written by
+// tuner generate --records.
+//
+//   recordtool stats <records>             counts the games and replays every position
+//   recordtool dump <records> [--games n]  prints every position and the move played in it
+#include "pch.h"
+
+#include "GameRecord.h"
+
+static void PrintUsage() {
+  fmt::print(
+      "usage:\n"
+      "  recordtool stats <records>\n"
+      "  recordtool dump <records> [--games n]\n");
+}
+
+static int Stats(const std::string& path) {
+  std::unique_ptr<GameRecordReader> reader = GameRecordReader::Open(path);
+  if (!reader)
+    return 1;
+
+  std::size_t games = 0;
+  std::size_t moves = 0;
+  std::array<std::size_t, 4> results = {0};
+  GameRecord game;
+  while (reader->Next(game)) {
+    games++;
+    moves += game.moves.size();
+    results[static_cast<int>(game.result)]++;
+  }
+  fmt::print("{} games, {} moves, {:.1f} bytes per move\n", games, moves,
+             moves > 0 ? static_cast<double>(std::filesystem::file_size(path)) / moves : 0.0);
+  fmt::print("x wins {}, o wins {}, draws {}, unfinished {}\n", results[static_cast<int>(GameStatus::XWins)],
+             results[static_cast<int>(GameStatus::OWins)], results[static_cast<int>(GameStatus::Draw)],
+             results[static_cast<int>(GameStatus::InProgress)]);
+  if (reader->GetSkippedBlocks() > 0)
+    fmt::print("{} damaged blocks skipped\n", reader->GetSkippedBlocks());
+
+  // a second pass replaying the games, as training would read them
+  reader = GameRecordReader::Open(path);
+  std::size_t positions = 0;
+  uint64_t checksum = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (const GameRecordReader::Position& position : *reader) {
+    positions++;
+    checksum += position.board.GetKey();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  fmt::print("replayed {} positions in {:.3f}s, {:.2f}M positions/s, checksum={:x}\n", positions, seconds,
+             positions / std::max(seconds, 1e-9) / 1e6, checksum);
+  return 0;
+}
+
+static int Dump(const std::string& path, std::size_t maxGames) {
+  std::unique_ptr<GameRecordReader> reader = GameRecordReader::Open(path);
+  if (!reader)
+    return 1;
+
+  const GameRecord* current = nullptr;
+  std::size_t games = 0;
+  for (const GameRecordReader::Position& position : *reader) {
+    if (position.ply == 0) {
+      if (games++ == maxGames)
+        break;
+      current = position.game;
+      fmt::print("game {}, {} moves, {}\n", games, current->moves.size(), current->result);
+    }
+    const GameRecord::RecordedMove& recorded = current->moves[position.ply];
+    fmt::print("  {} {} score={} visits={}\n", position.board.ToNotation(), recorded.move, recorded.score,
+               recorded.visits);
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    PrintUsage();
+    return 1;
+  }
+  spdlog::set_level(spdlog::level::warn);
+
+  std::string command = argv[1];
+  try {
+    if (command == "stats" && argc == 3)
+      return Stats(argv[2]);
+    if (command == "dump") {
+      std::size_t maxGames = std::numeric_limits<std::size_t>::max();
+      if (argc == 5 && std::string(argv[3]) == "--games")
+        maxGames = std::stoull(argv[4]);
+      else if (argc != 3)
+        throw std::invalid_argument("Unexpected arguments");
+      return Dump(argv[2], maxGames);
+    }
+  } catch (const std::exception& e) {
+    fmt::print(stderr, "{}\n", e.what());
+  }
+  PrintUsage();
+  return 1;
+}
@@ -0,0 +1,198 @@
+// Compares playing many games at once with a thread per game against
+// running them as coroutines on a GameScheduler. Players think for a
+// fixed time, standing in for a client or a clock, then play a random
+// legal move; with --engine both sides are engines searching instead.
+//
+//   schedulerbench [--games n] [--threads n] [--think ms] [--engine config] [--mode both|threads|scheduler]
+//
+// Reports the wall time and the games per second of every mode.
+#include "pch.h"
+
+#include "GameScheduler.h"
+#include "HeadlessGame.h"
+#include "players/AIPlayer.h"
+
+struct Options {
+  int games = 1000;
+  int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+  int think = 1;
+  std::optional<AIConfig> engine;
+  std::string mode = "both";
+};
+
+static void PrintUsage() {
+  fmt::print(
+      "usage: schedulerbench [options]\n"
+      "  --games <n>         games played at once (default 1000)\n"
+      "  --threads <n>       scheduler threads (default: all cores)\n"
+      "  --think <ms>        time a player waits before each move (default 1)\n"
+      "  --engine <config>   engines play instead, e.g. depth=3\n"
+      "  --mode <mode>       both, threads or scheduler (default both)\n");
+}
+
+static Options ParseOptions(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc)
+      throw std::invalid_argument("Missing value for " + arg);
+    std::string value = argv[++i];
+
+    if (arg == "--games")
+      options.games = std::max(1, std::stoi(value));
+    else if (arg == "--threads")
+      options.threads = std::max(1, std::stoi(value));
+    else if (arg == "--think")
+      options.think = std::max(0, std::stoi(value));
+    else if (arg == "--engine")
+      options.engine = AIConfig::Parse(value);
+    else if (arg == "--mode" && (value == "both" || value == "threads" || value == "scheduler"))
+      options.mode = value;
+    else
+      throw std::invalid_argument("Unknown option " + arg);
+  }
+  return options;
+}
+
+/**
+ * Waits, then plays a random legal move. The sync version blocks its
+ * thread while waiting, the async one suspends on the scheduler
+ */
+class ThinkingPlayer : public Player {
+public:
+  ThinkingPlayer(std::chrono::milliseconds think, uint32_t seed)
+      : m_think(think), m_rng(seed) {}
+
+  virtual void Initialize(PlayerSymbol, const Board& board) override { m_board = board; }
+  virtual void Terminate() override {}
+
+  virtual Move GetMove() override {
+    std::this_thread::sleep_for(m_think);
+    return Choose();
+  }
+
+  virtual Task<Move> GetMoveAsync(GameScheduler& scheduler) override {
+    co_await scheduler.Sleep(m_think);
+    co_return Choose();
+  }
+
+  virtual void ReceiveMove(const Move& move) override { m_board.Play(move); }
+  virtual void Reset() override { m_board = Board(); }
+
+private:
+  Move Choose() {
+    std::vector<Move> moves = m_board.GetLegalMoves();
+    Move move = moves[m_rng() % moves.size()];
+    m_board.Play(move);
+    return move;
+  }
+
+  std::chrono::milliseconds m_think;
+  Board m_board;
+  std::mt19937 m_rng;
+};
+
+struct Match {
+  std::unique_ptr<Player> playerX;
+  std::unique_ptr<Player> playerO;
+  std::unique_ptr<HeadlessGame> game;
+};
+
+static std::vector<Match> MakeMatches(const Options& options) {
+  std::vector<Match> matches(options.games);
+  for (int i = 0; i < options.games; i++) {
+    Match& match = matches[i];
+    if (options.engine) {
+      match.playerX = std::make_unique<AIPlayer>(*options.engine);
+      match.playerO = std::make_unique<AIPlayer>(*options.engine);
+    } else {
+      auto think = std::chrono::milliseconds(options.think);
+      match.playerX = std::make_unique<ThinkingPlayer>(think, static_cast<uint32_t>(2 * i));
+      match.playerO = std::make_unique<ThinkingPlayer>(think, static_cast<uint32_t>(2 * i + 1));
+    }
+    match.game = std::make_unique<HeadlessGame>(*match.playerX, *match.playerO);
+  }
+  return matches;
+}
+
+struct Result {
+  double seconds = 0;
+  int games = 0;
+  uint64_t plies = 0;
+};
+
+static void Report(const char* mode, int threads, const Result& result) {
+  fmt::print("{:<10} threads={:<5} games={} plies={} time_s={:.3f} games_per_s={:.1f}\n", mode, threads,
+             result.games, result.plies, result.seconds, result.games / result.seconds);
+}
+
+static uint64_t CountPlies(const std::vector<Match>& matches) {
+  uint64_t plies = 0;
+  for (const Match& match : matches) {
+    const Board& board = match.game->GetBoard();
+    for (int idx = 0; idx < 9 * 9; idx++)
+      plies += board.GetPieceAt(idx / 9, idx % 9) != Piece::Empty;
+  }
+  return plies;
+}
+
+static Result RunThreads(const Options& options) {
+  std::vector<Match> matches = MakeMatches(options);
+  std::vector<std::thread> threads;
+  threads.reserve(matches.size());
+  const auto start = std::chrono::steady_clock::now();
+  try {
+    for (Match& match : matches)
+      threads.emplace_back([&match] { match.game->Play(Board()); });
+  } catch (const std::system_error&) {
+    for (std::thread& thread : threads)
+      thread.join();
+    throw;
+  }
+  for (std::thread& thread : threads)
+    thread.join();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return {seconds, options.games, CountPlies(matches)};
+}
+
+static Task<void> PlayMatch(GameScheduler& scheduler, Match& match) {
+  co_await match.game->PlayAsync(scheduler, Board());
+}
+
+static Result RunScheduler(const Options& options) {
+  std::vector<Match> matches = MakeMatches(options);
+  const auto start = std::chrono::steady_clock::now();
+  {
+    GameScheduler scheduler(options.threads);
+    for (Match& match : matches)
+      scheduler.Spawn(PlayMatch(scheduler, match));
+    scheduler.WaitIdle();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return {seconds, options.games, CountPlies(matches)};
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  try {
+    options = ParseOptions(argc, argv);
+  } catch (const std::exception& e) {
+    fmt::print(stderr, "{}\n", e.what());
+    PrintUsage();
+    return 1;
+  }
+  spdlog::set_level(spdlog::level::warn);
+
+  if (options.mode != "scheduler") {
+    try {
+      Report("threads", options.games, RunThreads(options));
+    } catch (const std::system_error& e) {
+      // out of threads, which is what the scheduler is for
+      fmt::print("threads    could not start {} threads: {}\n", options.games, e.what());
+    }
+  }
+  if (options.mode != "threads")
+    Report("scheduler", options.threads, RunScheduler(options));
+  AIPlayer::SaveScoreCaches();
+  return 0;
+}
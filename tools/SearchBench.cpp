@@ -0,0 +1,141 @@
+// Searches a fixed set of reference positions and reports the node
+// counts and times, to compare search changes on equal footing.
+//
+//   searchbench [--engine config]... [--log file] [--events file] [--sync-log] [--expect-no-allocations]
+//
+// Every --engine is benchmarked in turn, e.g.
+//
+//   searchbench --engine depth=4,pvs=0,aspiration=0 --engine depth=4
+//
+// --log writes the debug log of the searches to a file and --events their
+// structured events, to compare the times with logging on and off.
+// --sync-log writes them on the searching thread instead of the logging one.
+//
+// Built with allocation tracking (cmake option EXTREME_TTT_ALLOC_TRACKING),
+// the heap allocations of every search are reported too. Then
+// --expect-no-allocations warms a player up on other positions and fails
+// if it allocates anything below the root moves when it searches the
+// reference ones, at depth 5 unless an --engine is given. The score map
+// keeps every position it scores, so it grows, and allocates, with every
+// new one: those allocations are counted apart and not checked.
+#include "pch.h"
+
+#include "Allocations.h"
+#include "BenchUtils.h"
+#include "Logging.h"
+#include "players/AIPlayer.h"
+
+static std::vector<Board> GetReferencePositions() {
+  return GetRandomPositions(20241030, {0, 2, 4, 6, 8, 10, 12, 14, 18, 22, 26, 30});
+}
+
+// other positions than the reference ones, which have an even number of pieces
+static std::vector<Board> GetWarmUpPositions() {
+  return GetRandomPositions(20241031, {1, 3, 5, 7, 9, 11, 13, 15, 19, 23, 27, 31});
+}
+
+/**
+ * Searches the positions with a player warmed up on other ones
+ *
+ * @return the number of searches that allocated below the root moves, the score map aside
+ */
+static int CountAllocatingSearches(const AIConfig& config, const std::vector<Board>& positions) {
+  AIPlayer player(config);
+  for (const Board& board : GetWarmUpPositions())
+    player.Analyze(board);
+
+  int allocatingSearches = 0;
+  for (std::size_t i = 0; i < positions.size(); i++) {
+    player.Analyze(positions[i]);
+    uint64_t treeAllocations = player.GetLastSearchStats().treeAllocations;
+    if (treeAllocations > 0) {
+      fmt::print("  position {:>2}: {} allocations below the root after warm-up\n", i, treeAllocations);
+      allocatingSearches++;
+    }
+  }
+  return allocatingSearches;
+}
+
+int main(int argc, char** argv) {
+  std::vector<AIConfig> configs;
+  Logging::Config logging;
+  logging.level = spdlog::level::warn;
+  bool expectNoAllocations = false;
+  try {
+    for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+      if (arg == "--sync-log") {
+        logging.isAsync = false;
+        continue;
+      }
+      if (arg == "--expect-no-allocations") {
+        expectNoAllocations = true;
+        continue;
+      }
+      if (i + 1 >= argc)
+        throw std::invalid_argument("Missing value for " + arg);
+      if (arg == "--engine")
+        configs.push_back(AIConfig::Parse(argv[++i]));
+      else if (arg == "--log")
+        logging.path = argv[++i];
+      else if (arg == "--events")
+        logging.eventsPath = argv[++i];
+      else
+        throw std::invalid_argument("Unexpected argument " + arg);
+    }
+  } catch (const std::exception& e) {
+    fmt::print(stderr,
+               "{}\nusage: searchbench [--engine config]... [--log file] [--events file] [--sync-log] "
+               "[--expect-no-allocations]\n",
+               e.what());
+    return 1;
+  }
+  if (expectNoAllocations && !Allocations::IsTracking()) {
+    fmt::print(stderr, "--expect-no-allocations needs a build with -DEXTREME_TTT_ALLOC_TRACKING=ON\n");
+    return 1;
+  }
+  if (configs.empty()) {
+    configs.emplace_back();
+    // deep enough for the search to use every part of the tree, e.g. reductions and re-searches
+    if (expectNoAllocations)
+      configs.back().depth = 5;
+  }
+
+  if (!logging.path.empty()) {
+    // the file gets everything compiled in, see SPDLOG_ACTIVE_LEVEL
+    logging.console = false;
+    logging.level = spdlog::level::trace;
+  }
+  if (!Logging::Init(logging))
+    return 1;
+  const std::vector<Board> positions = GetReferencePositions();
+
+  int allocatingSearches = 0;
+  for (const AIConfig& config : configs) {
+    fmt::print("engine: {}\n", config);
+    SearchStats total;
+    for (std::size_t i = 0; i < positions.size(); i++) {
+      // a fresh player for every position, so no cache is carried over
+      AIPlayer player(config);
+      player.Initialize(positions[i].GetCurrentPlayer(), positions[i]);
+      Move move = player.GetMove();
+      const SearchStats& stats = player.GetLastSearchStats();
+      std::string allocations =
+          Allocations::IsTracking()
+              ? fmt::format(" allocations={} tree_allocations={} score_map_allocations={}", stats.allocations,
+                            stats.treeAllocations, stats.scoreMapAllocations)
+              : "";
+      fmt::print("  position {:>2}: {} nodes={} time_ms={:.1f}{}\n", i, move, stats.nodes,
+                 std::chrono::duration<double, std::milli>(stats.elapsed).count(), allocations);
+      total.Merge(stats);
+    }
+    fmt::print("  total: {}\n", total);
+    if (expectNoAllocations)
+      allocatingSearches += CountAllocatingSearches(config, positions);
+  }
+  AIPlayer::SaveScoreCaches();
+  Logging::Shutdown();
+  if (expectNoAllocations)
+    fmt::print("{} searches allocated after warm-up\n", allocatingSearches);
+  return allocatingSearches == 0 ? 0 : 1;
+}
@@ -0,0 +1,253 @@
+// Plays two engine configurations against each other on all cores,
+// estimates the Elo difference and stops early once a sequential
+// probability ratio test (SPRT) reaches a conclusion.
+//
+//   tournament --engine1 depth=4 --engine2 depth=3 --games 2000
+//
+// With --tc the engines play on a clock instead of to their depth, so a
+// tournament takes the same time whatever the engines do:
+//
+//   tournament --engine1 lmr=1 --engine2 lmr=0 --tc 10+0.1
+//
+// Results are always given from the point of view of engine1.
+#include "pch.h"
+
+#include "HeadlessGame.h"
+#include "players/AIPlayer.h"
+
+struct Options {
+  AIConfig engine1;
+  AIConfig engine2;
+  int games = 1000;
+  int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+  int openingPlies = 4;
+  // the engines search to their depth without a clock
+  std::optional<TimeControl> timeControl;
+  uint32_t seed = 1;
+  // SPRT hypotheses (in Elo) and error rates
+  double elo0 = 0;
+  double elo1 = 10;
+  double alpha = 0.05;
+  double beta = 0.05;
+  bool verbose = false;
+};
+
+static void PrintUsage() {
+  fmt::print(
+      "usage: tournament [options]\n"
+      "  --engine1 <config>     candidate engine, e.g. depth=4 (default: defaults)\n"
+      "  --engine2 <config>     baseline engine (default: defaults)\n"
+      "  --games <n>            maximum number of games (default 1000)\n"
+      "  --threads <n>          number of games played at once (default: all cores)\n"
+      "  --opening-plies <n>    random plies played before the engines take over (default 4)\n"
+      "  --tc <base+inc>        clock of each engine in seconds, e.g. 10+0.1 (default: none)\n"
+      "  --seed <n>             seed of the opening generator (default 1)\n"
+      "  --elo0 <elo>           SPRT null hypothesis (default 0)\n"
+      "  --elo1 <elo>           SPRT alternative hypothesis (default 10)\n"
+      "  --alpha <p>            SPRT false positive rate (default 0.05)\n"
+      "  --beta <p>             SPRT false negative rate (default 0.05)\n"
+      "  --verbose              keep the engine logs\n");
+}
+
+static Options ParseOptions(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--verbose") {
+      options.verbose = true;
+      continue;
+    }
+    if (i + 1 >= argc)
+      throw std::invalid_argument("Missing value for " + arg);
+    std::string value = argv[++i];
+
+    if (arg == "--engine1")
+      options.engine1 = AIConfig::Parse(value);
+    else if (arg == "--engine2")
+      options.engine2 = AIConfig::Parse(value);
+    else if (arg == "--games")
+      options.games = std::stoi(value);
+    else if (arg == "--threads")
+      options.threads = std::max(1, std::stoi(value));
+    else if (arg == "--opening-plies")
+      options.openingPlies = std::stoi(value);
+    else if (arg == "--tc")
+      options.timeControl = TimeControl::Parse(value);
+    else if (arg == "--seed")
+      options.seed = static_cast<uint32_t>(std::stoul(value));
+    else if (arg == "--elo0")
+      options.elo0 = std::stod(value);
+    else if (arg == "--elo1")
+      options.elo1 = std::stod(value);
+    else if (arg == "--alpha")
+      options.alpha = std::stod(value);
+    else if (arg == "--beta")
+      options.beta = std::stod(value);
+    else
+      throw std::invalid_argument("Unknown option " + arg);
+  }
+  return options;
+}
+
+/**
+ * Plays random legal moves from the empty board. Each opening is derived
+ * from its own index so the set does not depend on the thread count.
+ */
+static Board MakeOpening(uint32_t seed, int index, int plies) {
+  std::mt19937 rng(seed * 7919u + static_cast<uint32_t>(index));
+  while (true) {
+    Board board;
+    for (int ply = 0; ply < plies && !board.IsGameOver(); ply++) {
+      std::vector<Move> moves = board.GetLegalMoves();
+      std::uniform_int_distribution<std::size_t> dist(0, moves.size() - 1);
+      board.Play(moves[dist(rng)]);
+    }
+    if (!board.IsGameOver())
+      return board;
+  }
+}
+
+struct Tally {
+  int wins = 0;
+  int draws = 0;
+  int losses = 0;
+  // games lost on time by each engine, included in the above
+  int engine1Flagged = 0;
+  int engine2Flagged = 0;
+
+  int Games() const { return wins + draws + losses; }
+  double Score() const { return Games() ? (wins + 0.5 * draws) / Games() : 0.5; }
+
+  // variance of the result of a single game
+  double Variance() const {
+    if (!Games())
+      return 0;
+    double s = Score();
+    return (wins * (1 - s) * (1 - s) + draws * (0.5 - s) * (0.5 - s) + losses * s * s) / Games();
+  }
+};
+
+static double ScoreToElo(double score) {
+  score = std::clamp(score, 1e-6, 1 - 1e-6);
+  return -400.0 * std::log10(1.0 / score - 1.0);
+}
+
+static double EloToScore(double elo) { return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0)); }
+
+/**
+ * Log likelihood ratio of elo1 against elo0, using
+ * the normal approximation of the trinomial model
+ */
+static double LogLikelihoodRatio(const Tally& tally, double elo0, double elo1) {
+  double variance = tally.Variance();
+  if (variance <= 0)
+    return 0;
+  double s0 = EloToScore(elo0);
+  double s1 = EloToScore(elo1);
+  return tally.Games() * (s1 - s0) * (2 * tally.Score() - s0 - s1) / (2 * variance);
+}
+
+static void PrintReport(const Tally& tally, double llr, double lower, double upper) {
+  double score = tally.Score();
+  // 95% confidence interval
+  double margin = 1.96 * std::sqrt(tally.Variance() / std::max(1, tally.Games()));
+  double elo = ScoreToElo(score);
+  double eloLow = ScoreToElo(score - margin);
+  double eloHigh = ScoreToElo(score + margin);
+  fmt::print("games={} W={} D={} L={} score={:.3f} elo={:+.1f} [{:+.1f}, {:+.1f}] llr={:.2f} ({:.2f}, {:.2f})\n",
+             tally.Games(), tally.wins, tally.draws, tally.losses, score,
+             elo, eloLow, eloHigh, llr, lower, upper);
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  try {
+    options = ParseOptions(argc, argv);
+  } catch (const std::exception& e) {
+    fmt::print(stderr, "{}\n", e.what());
+    PrintUsage();
+    return 1;
+  }
+
+  // every engine move is logged at info level
+  spdlog::set_level(options.verbose ? spdlog::level::info : spdlog::level::warn);
+
+  const double lower = std::log(options.beta / (1 - options.alpha));
+  const double upper = std::log((1 - options.beta) / options.alpha);
+  fmt::print("engine1: {}\nengine2: {}\n", options.engine1, options.engine2);
+  fmt::print("up to {} games on {} threads, SPRT elo0={} elo1={} alpha={} beta={}\n",
+             options.games, options.threads, options.elo0, options.elo1, options.alpha, options.beta);
+
+  std::mutex tallyMutex;
+  Tally tally;
+  double llr = 0;
+  std::atomic<int> nextPair = 0;
+  std::atomic<bool> stop = false;
+  const int pairs = (options.games + 1) / 2;
+
+  auto worker = [&] {
+    // each worker owns its engines, they are reset between games
+    AIPlayer engine1(options.engine1);
+    AIPlayer engine2(options.engine2);
+    HeadlessGame engine1White(engine1, engine2);
+    HeadlessGame engine2White(engine2, engine1);
+    engine1White.SetTimeControl(options.timeControl);
+    engine2White.SetTimeControl(options.timeControl);
+
+    int pair;
+    while (!stop && (pair = nextPair++) < pairs) {
+      Board opening = MakeOpening(options.seed, pair, options.openingPlies);
+
+      // the same opening is played once with each colour
+      for (int game = 0; game < 2 && !stop; game++) {
+        bool engine1IsX = game == 0;
+        HeadlessGame& headlessGame = engine1IsX ? engine1White : engine2White;
+        GameStatus status = headlessGame.Play(opening);
+
+        std::lock_guard<std::mutex> lock(tallyMutex);
+        if (tally.Games() >= options.games)
+          break;
+        if (status == GameStatus::Draw)
+          tally.draws++;
+        else if ((status == GameStatus::XWins) == engine1IsX)
+          tally.wins++;
+        else
+          tally.losses++;
+        if (std::optional<PlayerSymbol> flagged = headlessGame.GetFlagged()) {
+          if ((*flagged == PlayerSymbol::X) == engine1IsX)
+            tally.engine1Flagged++;
+          else
+            tally.engine2Flagged++;
+        }
+
+        llr = LogLikelihoodRatio(tally, options.elo0, options.elo1);
+        if (llr <= lower || llr >= upper)
+          stop = true;
+        // the last game is reported once all the workers are done
+        if (tally.Games() % 100 == 0 && !stop && tally.Games() < options.games)
+          PrintReport(tally, llr, lower, upper);
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < options.threads; i++)
+    threads.emplace_back(worker);
+  for (std::thread& thread : threads)
+    thread.join();
+
+  PrintReport(tally, llr, lower, upper);
+  if (llr >= upper)
+    fmt::print("SPRT: H1 accepted, engine1 is stronger by at least {} elo\n", options.elo1);
+  else if (llr <= lower)
+    fmt::print("SPRT: H0 accepted, engine1 is not stronger by {} elo\n", options.elo1);
+  else
+    fmt::print("SPRT: inconclusive after {} games\n", tally.Games());
+  if (options.timeControl)
+    fmt::print("time control {}: engine1 lost {} games on time, engine2 {}\n", *options.timeControl,
+               tally.engine1Flagged, tally.engine2Flagged);
+
+  SPDLOG_INFO("Search totals: {}", AIPlayer::GetTotalSearchStats());
+  AIPlayer::SaveScoreCaches();
+  return 0;
+}
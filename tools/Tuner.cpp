@@ -0,0 +1,432 @@
+// Tunes the weights of the hand written evaluation (players/Evaluation.h)
+// on positions labelled with the outcome of the game they come from.
+//
+//   tuner generate <positions> [options]        plays self-play games and writes their positions
+//   tuner tune <positions> <weights> [options]  fits the weights and writes them
+//
+// Positions are stored one per line, as the 81 cells read row by row
+// (x, o or .), the board and cell of the last move and the result of
+// the game for X (1, 0.5 or 0):
+//
+//   x.o......(...) 4 2 0.5
+//
+// The tuned weights are loaded by the engine with weights=<file>.
+// With --records the games are also written as game records
+// (GameRecord.h), with the score and searched positions of every move.
+#include "pch.h"
+
+#include "GameRecord.h"
+#include "HeadlessGame.h"
+#include "players/AIPlayer.h"
+
+struct Options {
+  AIConfig engine;
+  int games = 1000;
+  int openingPlies = 6;
+  uint32_t seed = 1;
+  int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+  std::string recordsPath;
+
+  std::string initialWeights;
+  int epochs = 300;
+  double learningRate = 1.0;
+  // scale of the sigmoid, found automatically when not given
+  double k = 0;
+};
+
+static void PrintUsage() {
+  fmt::print(
+      "usage:\n"
+      "  tuner generate <positions> [--games n] [--engine config] [--opening-plies n] [--seed n] [--threads n]\n"
+      "                   [--records file]\n"
+      "  tuner tune <positions> <weights> [--weights initial] [--epochs n] [--lr rate] [--k scale] [--threads n]\n");
+}
+
+static Options ParseOptions(int first, int argc, char** argv) {
+  Options options;
+  for (int i = first; i < argc; i++) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc)
+      throw std::invalid_argument("Missing value for " + arg);
+    std::string value = argv[++i];
+
+    if (arg == "--games")
+      options.games = std::stoi(value);
+    else if (arg == "--engine")
+      options.engine = AIConfig::Parse(value);
+    else if (arg == "--opening-plies")
+      options.openingPlies = std::stoi(value);
+    else if (arg == "--seed")
+      options.seed = static_cast<uint32_t>(std::stoul(value));
+    else if (arg == "--threads")
+      options.threads = std::max(1, std::stoi(value));
+    else if (arg == "--records")
+      options.recordsPath = value;
+    else if (arg == "--weights")
+      options.initialWeights = value;
+    else if (arg == "--epochs")
+      options.epochs = std::stoi(value);
+    else if (arg == "--lr")
+      options.learningRate = std::stod(value);
+    else if (arg == "--k")
+      options.k = std::stod(value);
+    else
+      throw std::invalid_argument("Unknown option " + arg);
+  }
+  return options;
+}
+
+static std::string ToLine(const Board& board, double result) {
+  std::string line;
+  line.reserve(81 + 16);
+  for (int row = 0; row < 9; row++) {
+    for (int col = 0; col < 9; col++) {
+      Piece piece = board.GetPieceAtRowCol(row, col);
+      line += piece == Piece::X ? 'x' : piece == Piece::O ? 'o'
+                                                          : '.';
+    }
+  }
+  Move lastMove = *board.GetLastMove();
+  line += fmt::format(" {} {} {}\n", lastMove.m_boardPosition, lastMove.m_cellPosition, result);
+  return line;
+}
+
+/**
+ * Records the positions of a game and labels them once the game is over,
+ * and the moves of the engine with how it found them
+ */
+class RecordingPlayer : public Player {
+public:
+  RecordingPlayer(AIPlayer& player, std::vector<Board>& positions, GameRecord& record)
+      : m_player(player), m_positions(positions), m_record(record) {}
+
+  virtual void Initialize(PlayerSymbol player, const Board& initial) override {
+    m_player.Initialize(player, initial);
+    m_board = initial;
+  }
+  virtual void Terminate() override { m_player.Terminate(); }
+  virtual Move GetMove() override {
+    m_positions.push_back(m_board);
+    Move move = m_player.GetMove();
+    m_board.Play(move);
+    static_assert(s_winScore <= std::numeric_limits<int16_t>::max(), "recorded scores are 16 bits");
+    m_record.moves.push_back({move, static_cast<int16_t>(m_player.GetLastScore()),
+                              static_cast<uint32_t>(m_player.GetLastSearchStats().nodes)});
+    return move;
+  }
+  virtual void ReceiveMove(const Move& move) override {
+    m_player.ReceiveMove(move);
+    m_board.Play(move);
+  }
+  virtual void Reset() override { m_player.Reset(); }
+
+private:
+  AIPlayer& m_player;
+  std::vector<Board>& m_positions;
+  GameRecord& m_record;
+  Board m_board;
+};
+
+static int Generate(const std::string& path, const Options& options) {
+  std::ofstream out(path);
+  if (!out) {
+    fmt::print(stderr, "Could not open {}\n", path);
+    return 1;
+  }
+  std::unique_ptr<GameRecordFile> records;
+  if (!options.recordsPath.empty()) {
+    records = GameRecordFile::Create(options.recordsPath, s_recordScores | s_recordVisits);
+    if (!records)
+      return 1;
+  }
+
+  std::mutex outMutex;
+  std::atomic<int> nextGame = 0;
+  std::atomic<uint64_t> written = 0;
+  auto worker = [&] {
+    AIPlayer engineX(options.engine);
+    AIPlayer engineO(options.engine);
+    std::vector<Board> positions;
+    GameRecord record;
+    RecordingPlayer recorderX(engineX, positions, record);
+    RecordingPlayer recorderO(engineO, positions, record);
+    HeadlessGame game(recorderX, recorderO);
+    // each thread fills its own blocks, they only lock the file to append one
+    std::optional<GameRecordWriter> writer;
+    if (records)
+      writer.emplace(*records);
+
+    int index;
+    while ((index = nextGame++) < options.games) {
+      // random openings, so the engines do not replay the same game
+      std::mt19937 rng(options.seed * 7919u + static_cast<uint32_t>(index));
+      Board opening;
+      record.moves.clear();
+      for (int ply = 0; ply < options.openingPlies && !opening.IsGameOver(); ply++) {
+        std::vector<Move> moves = opening.GetLegalMoves();
+        Move move = moves[rng() % moves.size()];
+        opening.Play(move);
+        record.moves.push_back({move});
+      }
+      if (opening.IsGameOver())
+        continue;
+
+      positions.clear();
+      GameStatus status = game.Play(opening);
+      if (writer) {
+        record.result = status;
+        writer->Write(record);
+      }
+      double result = status == GameStatus::XWins ? 1 : status == GameStatus::OWins ? 0
+                                                                                    : 0.5;
+      std::string lines;
+      for (const Board& position : positions) {
+        // the notation needs the last move
+        if (position.GetLastMove())
+          lines += ToLine(position, result);
+      }
+
+      std::lock_guard<std::mutex> lock(outMutex);
+      out << lines;
+      written += std::count(lines.begin(), lines.end(), '\n');
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < options.threads; i++)
+    threads.emplace_back(worker);
+  for (std::thread& thread : threads)
+    thread.join();
+
+  fmt::print("Wrote {} positions from {} games to {}\n", written.load(), options.games, path);
+  if (records)
+    fmt::print("Wrote the games to {}\n", options.recordsPath);
+  AIPlayer::SaveScoreCaches();
+  return 0;
+}
+
+/**
+ * Positions are only kept as their evaluation features and result,
+ * a few bytes each, so tens of millions of them fit in memory
+ */
+struct Dataset {
+  std::vector<EvalFeatures> features;
+  std::vector<float> results;
+
+  std::size_t Size() const { return results.size(); }
+};
+
+static std::optional<std::pair<EvalFeatures, float>> ParseLine(const std::string& line) {
+  std::istringstream ss(line);
+  std::string cells;
+  int lastBoard, lastCell;
+  float result;
+  if (!(ss >> cells >> lastBoard >> lastCell >> result) || cells.size() != 81 ||
+      lastBoard < 0 || lastBoard > 8 || lastCell < 0 || lastCell > 8)
+    return std::nullopt;
+
+  Board board(cells, Move(lastBoard, lastCell));
+  // finished positions are scored exactly by the search
+  if (board.IsGameOver())
+    return std::nullopt;
+  return std::make_pair(ExtractFeatures(board), result);
+}
+
+/**
+ * Streams the file in chunks of lines that are parsed in parallel,
+ * only one chunk of text is in memory at a time
+ */
+static Dataset Load(const std::string& path, int threads) {
+  static constexpr std::size_t s_chunkSize = 1 << 20;
+
+  Dataset dataset;
+  std::ifstream in(path);
+  if (!in) {
+    fmt::print(stderr, "Could not open {}\n", path);
+    return dataset;
+  }
+
+  std::vector<std::string> lines;
+  std::vector<std::optional<std::pair<EvalFeatures, float>>> parsed;
+  std::size_t skipped = 0;
+  while (in) {
+    lines.clear();
+    std::string line;
+    while (lines.size() < s_chunkSize && std::getline(in, line))
+      lines.push_back(std::move(line));
+
+    parsed.assign(lines.size(), std::nullopt);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+      workers.emplace_back([&, t] {
+        for (std::size_t i = t; i < lines.size(); i += threads)
+          parsed[i] = ParseLine(lines[i]);
+      });
+    }
+    for (std::thread& worker : workers)
+      worker.join();
+
+    for (const auto& position : parsed) {
+      if (!position) {
+        skipped++;
+        continue;
+      }
+      dataset.features.push_back(position->first);
+      dataset.results.push_back(position->second);
+    }
+  }
+
+  dataset.features.shrink_to_fit();
+  dataset.results.shrink_to_fit();
+  fmt::print("Loaded {} positions from {} ({} skipped)\n", dataset.Size(), path, skipped);
+  return dataset;
+}
+
+static double Sigmoid(double x) { return 1.0 / (1.0 + std::exp(-x)); }
+
+struct Gradient {
+  double loss = 0;
+  std::array<double, s_evalTermCount> weights = {0};
+};
+
+/**
+ * Computes the mean logistic loss and its gradient over the dataset,
+ * each thread works on its own slice and the results are summed
+ */
+static Gradient ComputeGradient(const Dataset& dataset,
+                                const std::array<double, s_evalTermCount>& weights,
+                                double k,
+                                int threads) {
+  std::vector<Gradient> partial(threads);
+  std::vector<std::thread> workers;
+  const std::size_t size = dataset.Size();
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&, t] {
+      Gradient& gradient = partial[t];
+      std::size_t begin = size * t / threads;
+      std::size_t end = size * (t + 1) / threads;
+      for (std::size_t i = begin; i < end; i++) {
+        const EvalFeatures& features = dataset.features[i];
+        double eval = 0;
+        for (int term = 0; term < s_evalTermCount; term++)
+          eval += features[term] * weights[term];
+
+        double predicted = std::clamp(Sigmoid(k * eval), 1e-9, 1 - 1e-9);
+        double result = dataset.results[i];
+        gradient.loss -= result * std::log(predicted) + (1 - result) * std::log(1 - predicted);
+        // derivative of the cross entropy through the sigmoid
+        double error = (predicted - result) * k;
+        for (int term = 0; term < s_evalTermCount; term++)
+          gradient.weights[term] += error * features[term];
+      }
+    });
+  }
+  for (std::thread& worker : workers)
+    worker.join();
+
+  Gradient total;
+  for (const Gradient& gradient : partial) {
+    total.loss += gradient.loss;
+    for (int term = 0; term < s_evalTermCount; term++)
+      total.weights[term] += gradient.weights[term];
+  }
+  double n = std::max<double>(1, static_cast<double>(size));
+  total.loss /= n;
+  for (double& w : total.weights)
+    w /= n;
+  return total;
+}
+
+static std::array<double, s_evalTermCount> ToDoubles(const EvalWeights& weights) {
+  std::array<double, s_evalTermCount> values;
+  for (int term = 0; term < s_evalTermCount; term++)
+    values[term] = weights.values[term];
+  return values;
+}
+
+/**
+ * Finds the sigmoid scale that best fits the initial weights,
+ * so the tuning only changes the relative value of the terms
+ */
+static double FitK(const Dataset& dataset, const std::array<double, s_evalTermCount>& weights, int threads) {
+  double bestK = 0;
+  double bestLoss = std::numeric_limits<double>::max();
+  for (double k = 0.0001; k < 0.1; k *= 1.25) {
+    double loss = ComputeGradient(dataset, weights, k, threads).loss;
+    if (loss < bestLoss) {
+      bestLoss = loss;
+      bestK = k;
+    }
+  }
+  return bestK;
+}
+
+static int Tune(const std::string& positionsPath, const std::string& weightsPath, const Options& options) {
+  EvalWeights initial;
+  if (!options.initialWeights.empty()) {
+    std::optional<EvalWeights> loaded = EvalWeights::Load(options.initialWeights);
+    if (!loaded)
+      return 1;
+    initial = *loaded;
+  }
+
+  Dataset dataset = Load(positionsPath, options.threads);
+  if (!dataset.Size())
+    return 1;
+
+  std::array<double, s_evalTermCount> weights = ToDoubles(initial);
+  double k = options.k > 0 ? options.k : FitK(dataset, weights, options.threads);
+  fmt::print("Using k={:.6f}\n", k);
+
+  // Adam, the terms have very different frequencies
+  const double beta1 = 0.9;
+  const double beta2 = 0.999;
+  std::array<double, s_evalTermCount> m = {0};
+  std::array<double, s_evalTermCount> v = {0};
+  for (int epoch = 1; epoch <= options.epochs; epoch++) {
+    Gradient gradient = ComputeGradient(dataset, weights, k, options.threads);
+    for (int term = 0; term < s_evalTermCount; term++) {
+      double g = gradient.weights[term];
+      m[term] = beta1 * m[term] + (1 - beta1) * g;
+      v[term] = beta2 * v[term] + (1 - beta2) * g * g;
+      double mHat = m[term] / (1 - std::pow(beta1, epoch));
+      double vHat = v[term] / (1 - std::pow(beta2, epoch));
+      weights[term] -= options.learningRate * mHat / (std::sqrt(vHat) + 1e-12);
+    }
+    if (epoch % 10 == 0 || epoch == 1)
+      fmt::print("epoch {} loss {:.6f}\n", epoch, gradient.loss);
+  }
+
+  EvalWeights tuned;
+  for (int term = 0; term < s_evalTermCount; term++) {
+    tuned.values[term] = static_cast<int32_t>(std::lround(weights[term]));
+    fmt::print("{:>18} {:>6} -> {:>6}\n", GetEvalTermName(static_cast<EvalTerm>(term)),
+               initial.values[term], tuned.values[term]);
+  }
+  if (!tuned.Save(weightsPath)) {
+    fmt::print(stderr, "Could not write {}\n", weightsPath);
+    return 1;
+  }
+  fmt::print("Wrote {}\n", weightsPath);
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    PrintUsage();
+    return 1;
+  }
+  spdlog::set_level(spdlog::level::warn);
+
+  std::string command = argv[1];
+  try {
+    if (command == "generate")
+      return Generate(argv[2], ParseOptions(3, argc, argv));
+    if (command == "tune" && argc >= 4)
+      return Tune(argv[2], argv[3], ParseOptions(4, argc, argv));
+  } catch (const std::exception& e) {
+    fmt::print(stderr, "{}\n", e.what());
+  }
+  PrintUsage();
+  return 1;
+}